@@ -1,272 +1,1473 @@
+#pragma once
+
 #include <iostream>
 #include <string>
 #include <vector>
-#include <complex>
+#include <cstdint>
+#include <algorithm>
+#include <iterator>
+#include <cmath>
+#include <cstring>
+#include <atomic>
+#include <mutex>
 
-const double PI = acos(-1.0);
+#include "../Parallel/parallel.h"
 
+namespace BigNumber {
 enum class Sign {
     plus = 1,
     minus = -1
 };
 
-Sign operator*(Sign x, Sign y) {
+inline Sign operator*(Sign x, Sign y) {
     if (x == y) return Sign::plus;
     else return Sign::minus;
 }
 
 class BigInteger {
 private:
-    std::vector<int> a;
+    using limb = uint64_t;
+    using double_limb = unsigned __int128;
+
+    // limb storage that keeps up to two limbs inside the object and only allocates for larger values
+    class Limbs {
+    private:
+        static const size_t inline_capacity = 2;
+
+        size_t length = 0;
+        size_t capacity = inline_capacity;
+        union {
+            limb local[inline_capacity];
+            limb* heap;
+        };
+
+        bool is_inline() const {
+            return capacity == inline_capacity;
+        }
+
+        void reserve(size_t n) {
+            if (n <= capacity) return;
+            size_t new_capacity = std::max(n, 2 * capacity);
+            limb* memory = new limb[new_capacity];
+            std::copy(begin(), end(), memory);
+            if (!is_inline()) delete[] heap;
+            heap = memory;
+            capacity = new_capacity;
+        }
+
+    public:
+        Limbs() {}
+
+        Limbs(std::initializer_list<limb> x) {
+            assign(x.begin(), x.end());
+        }
+
+        Limbs(const Limbs& x) {
+            assign(x.begin(), x.end());
+        }
+
+        Limbs(Limbs&& x) noexcept {
+            *this = std::move(x);
+        }
+
+        ~Limbs() {
+            if (!is_inline()) delete[] heap;
+        }
+
+        Limbs& operator=(const Limbs& x) {
+            if (this != &x) assign(x.begin(), x.end());
+            return *this;
+        }
+
+        Limbs& operator=(Limbs&& x) noexcept {
+            if (this == &x) return *this;
+            if (!is_inline()) delete[] heap;
+            length = x.length;
+            capacity = x.capacity;
+            if (x.is_inline()) std::copy(x.local, x.local + x.length, local);
+            else heap = x.heap;
+            x.length = 0;
+            x.capacity = inline_capacity;
+            return *this;
+        }
+
+        Limbs& operator=(const std::vector<limb>& x) {
+            assign(x.data(), x.data() + x.size());
+            return *this;
+        }
+
+        void assign(const limb* first, const limb* last) {
+            length = 0;
+            reserve(last - first);
+            std::copy(first, last, data());
+            length = last - first;
+        }
+
+        void assign(size_t n, limb value) {
+            length = 0;
+            reserve(n);
+            std::fill_n(data(), n, value);
+            length = n;
+        }
+
+        void resize(size_t n, limb value = 0) {
+            reserve(n);
+            if (n > length) std::fill(data() + length, data() + n, value);
+            length = n;
+        }
+
+        void push_back(limb value) {
+            reserve(length + 1);
+            data()[length++] = value;
+        }
+
+        void pop_back() {
+            length--;
+        }
+
+        limb* data() {
+            return is_inline() ? local : heap;
+        }
+
+        const limb* data() const {
+            return is_inline() ? local : heap;
+        }
+
+        limb* begin() {
+            return data();
+        }
+
+        limb* end() {
+            return data() + length;
+        }
+
+        const limb* begin() const {
+            return data();
+        }
+
+        const limb* end() const {
+            return data() + length;
+        }
+
+        limb& operator[](size_t i) {
+            return data()[i];
+        }
+
+        const limb& operator[](size_t i) const {
+            return data()[i];
+        }
+
+        limb& back() {
+            return data()[length - 1];
+        }
+
+        const limb& back() const {
+            return data()[length - 1];
+        }
+
+        size_t size() const {
+            return length;
+        }
+
+        bool empty() const {
+            return length == 0;
+        }
+    };
+
+    Limbs a;
     Sign sign = Sign::plus;
-    static const int base = 100;
-    static const size_t base_len = 2;
+    static const size_t limb_bits = 64;
+    static const limb decimal_base = 10000000000000000000ull;
+    static const size_t decimal_base_len = 19;
+    static const size_t ntt_prime_count = 3;
+
+    // operand sizes in limbs at which multiplication switches algorithm, the smaller operand decides
+    static const size_t karatsuba_threshold = 32;
+    static const size_t toom3_threshold = 250;
+    static const size_t ntt_threshold = 800;
+
+    // transform length in limbs from which the NTT spreads its passes over the shared pool,
+    // in tasks of parallel_ntt_grain positions
+    static const size_t parallel_ntt_threshold = 1 << 16;
+    static const size_t parallel_ntt_grain = 1 << 13;
+
+    // divisor sizes in limbs at which division switches from Knuth's algorithm D to Burnikel-Ziegler
+    // and from that to Barrett reduction with a Newton reciprocal
+    static const size_t bz_threshold = 40;
+    static const size_t newton_threshold = 2000;
+
+    // number size in limbs below which decimal conversion stops splitting and works 19 digits at a time
+    static const size_t radix_conversion_threshold = 30;
+
+    // number size in limbs from which gcd reduces the top half recursively instead of running plain Lehmer steps
+    static const size_t hgcd_threshold = 100;
 
 private:
-    static std::string number_to_string(int x) {
-        std::string result = std::to_string(x);
-        return std::string(base_len - result.size(), '0') + result;
+    template <typename Vector>
+    static void delete_trailing_zeroes(Vector& x) {
+        while (x.size() > 1 && x.back() == 0) x.pop_back();
+    }
+
+    static Sign sgn(int x) {
+        return static_cast<Sign>((0 <= x) - (x < 0));
+    }
+
+    static int compare_limbs(const limb* x, size_t n, const limb* y, size_t m) {
+        if (n != m) return n < m ? -1 : 1;
+        for (size_t i = n; i-- > 0;) {
+            if (x[i] != y[i]) return x[i] < y[i] ? -1 : 1;
+        }
+        return 0;
+    }
+
+    // r = x + y for n >= m, r has room for n limbs, returns the carry out of the top limb
+    static limb add_limbs(limb* r, const limb* x, size_t n, const limb* y, size_t m) {
+        limb carry = 0;
+        for (size_t i = 0; i < m; i++) {
+            double_limb cur = static_cast<double_limb>(x[i]) + y[i] + carry;
+            r[i] = static_cast<limb>(cur);
+            carry = static_cast<limb>(cur >> limb_bits);
+        }
+        for (size_t i = m; i < n; i++) {
+            r[i] = x[i] + carry;
+            carry = (r[i] < carry);
+        }
+        return carry;
+    }
+
+    // r = x - y for n >= m, returns the borrow out of the top limb
+    static limb sub_limbs(limb* r, const limb* x, size_t n, const limb* y, size_t m) {
+        limb borrow = 0;
+        for (size_t i = 0; i < m; i++) {
+            limb cur = x[i] - y[i];
+            limb next_borrow = (x[i] < y[i]) | (cur < borrow);
+            r[i] = cur - borrow;
+            borrow = next_borrow;
+        }
+        for (size_t i = m; i < n; i++) {
+            limb cur = x[i];
+            r[i] = cur - borrow;
+            borrow = (cur < borrow);
+        }
+        return borrow;
+    }
+
+    // r = x * y, returns the limb carried out of the top
+    static limb mul_limb(limb* r, const limb* x, size_t n, limb y) {
+        limb carry = 0;
+        for (size_t i = 0; i < n; i++) {
+            double_limb cur = static_cast<double_limb>(x[i]) * y + carry;
+            r[i] = static_cast<limb>(cur);
+            carry = static_cast<limb>(cur >> limb_bits);
+        }
+        return carry;
+    }
+
+    // r += x * y, returns the limb carried out of the top
+    static limb addmul_limb(limb* r, const limb* x, size_t n, limb y) {
+        limb carry = 0;
+        for (size_t i = 0; i < n; i++) {
+            double_limb cur = static_cast<double_limb>(x[i]) * y + r[i] + carry;
+            r[i] = static_cast<limb>(cur);
+            carry = static_cast<limb>(cur >> limb_bits);
+        }
+        return carry;
+    }
+
+    // q = x / y, returns x % y
+    static limb divmod_limb(limb* q, const limb* x, size_t n, limb y) {
+        double_limb rem = 0;
+        for (size_t i = n; i-- > 0;) {
+            double_limb cur = (rem << limb_bits) | x[i];
+            q[i] = static_cast<limb>(cur / y);
+            rem = cur % y;
+        }
+        return static_cast<limb>(rem);
+    }
+
+    struct Montgomery {
+        limb mod;
+        limb mod_inv;
+        limb one;
+        limb r2;
+
+        explicit Montgomery(limb mod) : mod(mod), mod_inv(mod) {
+            for (int i = 0; i < 5; i++) mod_inv *= 2 - mod * mod_inv;
+            one = static_cast<limb>((static_cast<double_limb>(1) << limb_bits) % mod);
+            r2 = static_cast<limb>(static_cast<double_limb>(one) * one % mod);
+        }
+
+        // t * 2^-64 mod mod shifted into (0, 2 * mod), valid for t < mod * 2^64
+        limb reduce_lazy(double_limb t) const {
+            limb m = static_cast<limb>(t) * mod_inv;
+            return static_cast<limb>(t >> limb_bits) - static_cast<limb>((static_cast<double_limb>(m) * mod) >> limb_bits) + mod;
+        }
+
+        limb reduce(double_limb t) const {
+            limb u = reduce_lazy(t);
+            return u >= mod ? u - mod : u;
+        }
+
+        limb mul_lazy(limb x, limb y) const {
+            return reduce_lazy(static_cast<double_limb>(x) * y);
+        }
+
+        limb mul(limb x, limb y) const {
+            return reduce(static_cast<double_limb>(x) * y);
+        }
+
+        limb add(limb x, limb y) const {
+            limb s = x + y;
+            return s >= mod ? s - mod : s;
+        }
+
+        limb sub(limb x, limb y) const {
+            return x >= y ? x - y : x + mod - y;
+        }
+
+        limb to_mont(limb x) const {
+            return mul(x, r2);
+        }
+
+        limb pow(limb x, limb m) const {
+            limb result = one;
+            while (m) {
+                if (m & 1) result = mul(result, x);
+                x = mul(x, x);
+                m >>= 1;
+            }
+            return result;
+        }
+    };
+
+    // roots[s][j] holds w^j for the primitive root w of order 2^(s + 1), in Montgomery form. A level is
+    // built once under the lock and never changes afterwards, so transforms on any thread may read it
+    struct NttTable {
+        Montgomery m;
+        limb generator;
+        std::vector<limb> roots[limb_bits];
+        std::vector<limb> inv_roots[limb_bits];
+        std::atomic<size_t> levels{0};
+        std::mutex mutex;
+
+        NttTable(limb mod, limb generator) : m(mod), generator(generator) {}
+
+        // makes the levels for transforms of length up to n available
+        void prepare(size_t n) {
+            size_t needed = 0;
+            while ((static_cast<size_t>(1) << needed) < n) needed++;
+            if (levels.load(std::memory_order_acquire) >= needed) return;
+            std::lock_guard<std::mutex> lock(mutex);
+            limb g = m.to_mont(generator);
+            for (size_t s = levels.load(std::memory_order_relaxed); s < needed; s++) {
+                size_t half = static_cast<size_t>(1) << s;
+                limb w = m.pow(g, (m.mod - 1) / (2 * half));
+                limb w_inv = m.pow(w, m.mod - 2);
+                roots[s].assign(half, m.one);
+                inv_roots[s].assign(half, m.one);
+                for (size_t j = 1; j < half; j++) {
+                    roots[s][j] = m.mul(roots[s][j - 1], w);
+                    inv_roots[s][j] = m.mul(inv_roots[s][j - 1], w_inv);
+                }
+            }
+            levels.store(std::max(needed, levels.load(std::memory_order_relaxed)), std::memory_order_release);
+        }
+    };
+
+    static NttTable& ntt_table(size_t i) {
+        static NttTable tables[ntt_prime_count] = {
+            NttTable(4611615649683210241ull, 11),
+            NttTable(4611613450659954689ull, 3),
+            NttTable(4611549678985543681ull, 19)
+        };
+        return tables[i];
+    }
+
+    // the number of transform positions handled by one task of a parallel transform of length len,
+    // or all of them when len is below the parallel threshold
+    static size_t ntt_grain(size_t len) {
+        return len >= parallel_ntt_threshold ? parallel_ntt_grain : len;
+    }
+
+    // calls butterfly(i + j, j) for the len / 2 butterflies of one stage, where i is the start of a block
+    // of 2 * half positions and j < half; consecutive butterflies go to the same task
+    template <typename Butterfly>
+    static void ntt_stage(size_t len, size_t half, Butterfly butterfly) {
+        Parallel::parallel_for(0, len / 2, ntt_grain(len) / 2, [&](size_t first, size_t last) {
+            for (size_t b = first; b < last;) {
+                size_t j = b & (half - 1);
+                size_t start = 2 * (b - j);
+                size_t end = std::min(half, j + (last - b));
+                b += end - j;
+                for (; j < end; j++) butterfly(start + j, j);
+            }
+        });
+    }
+
+    // forward transform is decimation in frequency and leaves the result in bit-reversed order,
+    // the inverse one consumes that order directly, so no permutation pass is needed;
+    // butterflies keep values in [0, 2 * mod) and skip the final reductions, which is safe as 4 * mod < 2^64.
+    // Long transforms spread every stage over the shared pool
+    static void NTT(limb* f, size_t n, const NttTable& table, bool invert) {
+        const Montgomery& m = table.m;
+        const limb two_mod = 2 * m.mod;
+        size_t s = 0;
+        while ((static_cast<size_t>(2) << s) < n) s++;
+        if (!invert) {
+            for (size_t half = n / 2; half > 0; half >>= 1, s--) {
+                const limb* w = table.roots[s].data();
+                ntt_stage(n, half, [&](size_t i, size_t j) {
+                    limb u = f[i], v = f[i + half];
+                    limb sum = u + v;
+                    f[i] = sum >= two_mod ? sum - two_mod : sum;
+                    f[i + half] = m.mul_lazy(u + two_mod - v, w[j]);
+                });
+            }
+        } else {
+            s = 0;
+            for (size_t half = 1; half < n; half <<= 1, s++) {
+                const limb* w = table.inv_roots[s].data();
+                ntt_stage(n, half, [&](size_t i, size_t j) {
+                    limb u = f[i], v = m.mul_lazy(f[i + half], w[j]);
+                    limb sum = u + v, d = u + two_mod - v;
+                    f[i] = sum >= two_mod ? sum - two_mod : sum;
+                    f[i + half] = d >= two_mod ? d - two_mod : d;
+                });
+            }
+        }
+    }
+
+    // r = x * y modulo the k-th prime for every coefficient of the cyclic convolution of length n
+    static void ntt_convolution(std::vector<limb>& r, const limb* x, size_t n, const limb* y, size_t m,
+                                size_t len, size_t k) {
+        NttTable& table = ntt_table(k);
+        const Montgomery& mont = table.m;
+        table.prepare(len);
+        size_t grain = ntt_grain(len);
+        r.assign(len, 0);
+        Parallel::parallel_for(0, n, grain, [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; i++) r[i] = mont.mul(x[i], mont.one);
+        });
+        NTT(r.data(), len, table, false);
+        if (x == y && n == m) {
+            Parallel::parallel_for(0, len, grain, [&](size_t first, size_t last) {
+                for (size_t i = first; i < last; i++) r[i] = mont.mul(r[i], r[i]);
+            });
+        } else {
+            std::vector<limb> f(len, 0);
+            Parallel::parallel_for(0, m, grain, [&](size_t first, size_t last) {
+                for (size_t i = first; i < last; i++) f[i] = mont.mul(y[i], mont.one);
+            });
+            NTT(f.data(), len, table, false);
+            Parallel::parallel_for(0, len, grain, [&](size_t first, size_t last) {
+                for (size_t i = first; i < last; i++) r[i] = mont.mul(r[i], f[i]);
+            });
+        }
+        NTT(r.data(), len, table, true);
+        // pointwise products carry an extra 2^-64, so scale by 2^128 / len in Montgomery terms
+        limb scale = mont.to_mont(mont.to_mont(mont.mod - (mont.mod - 1) / len));
+        Parallel::parallel_for(0, len, grain, [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; i++) r[i] = mont.mul(r[i], scale);
+        });
+    }
+
+    // recovers the coefficient below p0 * p1 * p2 from its three residues as three limbs
+    static void garner(limb r0, limb r1, limb r2, limb* out) {
+        const Montgomery& m1 = ntt_table(1).m;
+        const Montgomery& m2 = ntt_table(2).m;
+        const limb p0 = ntt_table(0).m.mod, p1 = m1.mod;
+        static const limb p0_inv_mod_p1 = m1.pow(m1.to_mont(p0), p1 - 2);
+        static const limb p0_mod_p2 = m2.to_mont(p0);
+        static const limb p0p1_inv_mod_p2 = m2.pow(m2.mul(p0_mod_p2, m2.to_mont(p1)), m2.mod - 2);
+        limb t1 = m1.mul(m1.sub(r1, m1.mul(r0, m1.one)), p0_inv_mod_p1);
+        limb s = m2.add(m2.mul(r0, m2.one), m2.mul(t1, p0_mod_p2));
+        limb t2 = m2.mul(m2.sub(r2, s), p0p1_inv_mod_p2);
+        double_limb p0p1 = static_cast<double_limb>(p0) * p1;
+        double_limb low = static_cast<double_limb>(p0) * t1 + r0;
+        double_limb cur = static_cast<double_limb>(t2) * static_cast<limb>(p0p1) + static_cast<limb>(low);
+        out[0] = static_cast<limb>(cur);
+        cur = static_cast<double_limb>(t2) * static_cast<limb>(p0p1 >> limb_bits)
+              + static_cast<limb>(low >> limb_bits) + (cur >> limb_bits);
+        out[1] = static_cast<limb>(cur);
+        out[2] = static_cast<limb>(cur >> limb_bits);
+    }
+
+    // r = x * y, r has room for n + m limbs
+    static void multiply_ntt(limb* r, const limb* x, size_t n, const limb* y, size_t m) {
+        size_t len = 1;
+        while (len < n + m - 1) len <<= 1;
+        std::vector<limb> residues[ntt_prime_count];
+        for (size_t k = 0; k < ntt_prime_count; k++) {
+            ntt_convolution(residues[k], x, n, y, m, len, k);
+        }
+        // every range of coefficients is recombined on its own with the two limbs it carries out kept aside,
+        // then those carries are added in one pass from the bottom
+        size_t grain = ntt_grain(len);
+        size_t ranges = (n + m + grain - 1) / grain;
+        std::vector<limb> carries(2 * ranges, 0);
+        Parallel::parallel_for(0, ranges, 1, [&](size_t first_range, size_t last_range) {
+            for (size_t t = first_range; t < last_range; t++) {
+                limb carry[3] = {0, 0, 0};
+                for (size_t i = t * grain; i < std::min(n + m, (t + 1) * grain); i++) {
+                    limb value[3] = {0, 0, 0};
+                    if (i < len) garner(residues[0][i], residues[1][i], residues[2][i], value);
+                    add_limbs(value, value, 3, carry, 3);
+                    r[i] = value[0];
+                    carry[0] = value[1];
+                    carry[1] = value[2];
+                    carry[2] = 0;
+                }
+                carries[2 * t] = carry[0];
+                carries[2 * t + 1] = carry[1];
+            }
+        });
+        for (size_t t = 0; t + 1 < ranges; t++) {
+            size_t start = (t + 1) * grain;
+            add_to(r + start, n + m - start, carries.data() + 2 * t, std::min<size_t>(2, n + m - start));
+        }
+    }
+
+    static void multiply_basecase(limb* r, const limb* x, size_t n, const limb* y, size_t m) {
+        r[n] = mul_limb(r, x, n, y[0]);
+        for (size_t j = 1; j < m; j++) {
+            r[n + j] = addmul_limb(r + j, x, n, y[j]);
+        }
+    }
+
+    // adds x to the n-limb window at r, the sum must fit in the window
+    static void add_to(limb* r, size_t n, const limb* x, size_t m) {
+        while (m > 0 && x[m - 1] == 0) m--;
+        add_limbs(r, r, n, x, m);
+    }
+
+    static void sub_from(limb* r, size_t n, const limb* x, size_t m) {
+        while (m > 0 && x[m - 1] == 0) m--;
+        sub_limbs(r, r, n, x, m);
+    }
+
+    // expects (n + 1) / 2 < m <= n
+    static void multiply_karatsuba(limb* r, const limb* x, size_t n, const limb* y, size_t m) {
+        size_t h = (n + 1) / 2;
+        multiply(r, x, h, y, h);
+        multiply(r + 2 * h, x + h, n - h, y + h, m - h);
+        std::vector<limb> sx(h + 1), sy(h + 1), mid(2 * h + 2);
+        sx[h] = add_limbs(sx.data(), x, h, x + h, n - h);
+        sy[h] = add_limbs(sy.data(), y, h, y + h, m - h);
+        multiply(mid.data(), sx.data(), h + 1, sy.data(), h + 1);
+        sub_from(mid.data(), mid.size(), r, 2 * h);
+        sub_from(mid.data(), mid.size(), r + 2 * h, n + m - 2 * h);
+        add_to(r + h, n + m - h, mid.data(), mid.size());
+    }
+
+    static BigInteger from_limbs(const limb* x, size_t n) {
+        BigInteger result;
+        if (n > 0) result.a.assign(x, x + n);
+        delete_trailing_zeroes(result.a);
+        return result;
+    }
+
+    static void divide_exact_small(BigInteger& x, limb d) {
+        divmod_limb(x.a.data(), x.a.data(), x.size(), d);
+        delete_trailing_zeroes(x.a);
+        if (x.is_zero()) x.sign = Sign::plus;
+    }
+
+    // Toom-3 with evaluation points 0, 1, -1, -2, infinity and Bodrato's interpolation sequence,
+    // expects 2 * ceil(n / 3) < m <= n
+    static void multiply_toom3(limb* r, const limb* x, size_t n, const limb* y, size_t m) {
+        size_t k = (n + 2) / 3;
+        BigInteger x0 = from_limbs(x, k), x1 = from_limbs(x + k, k), x2 = from_limbs(x + 2 * k, n - 2 * k);
+        BigInteger y0 = from_limbs(y, k), y1 = from_limbs(y + k, k), y2 = from_limbs(y + 2 * k, m - 2 * k);
+        BigInteger px = x0, py = y0;
+        px += x2;
+        py += y2;
+        BigInteger x_m1 = px, y_m1 = py;
+        x_m1 -= x1;
+        y_m1 -= y1;
+        BigInteger x_m2 = x_m1, y_m2 = y_m1;
+        x_m2 += x2;
+        x_m2 += x_m2;
+        x_m2 -= x0;
+        y_m2 += y2;
+        y_m2 += y_m2;
+        y_m2 -= y0;
+        px += x1;
+        py += y1;
+        BigInteger r0 = x0, r1 = px, r_m1 = x_m1, r3 = x_m2, r4 = x2;
+        r0 *= y0;
+        r1 *= py;
+        r_m1 *= y_m1;
+        r3 *= y_m2;
+        r4 *= y2;
+        r3 -= r1;
+        divide_exact_small(r3, 3);
+        r1 -= r_m1;
+        divide_exact_small(r1, 2);
+        BigInteger r2 = r_m1;
+        r2 -= r0;
+        r3 -= r2;
+        r3.sign = r3.sign * Sign::minus;
+        divide_exact_small(r3, 2);
+        r3 += r4;
+        r3 += r4;
+        r2 += r1;
+        r2 -= r4;
+        r1 -= r3;
+        std::fill(r, r + n + m, 0);
+        const BigInteger* parts[5] = {&r0, &r1, &r2, &r3, &r4};
+        for (size_t i = 0; i < 5; i++) {
+            add_to(r + i * k, n + m - i * k, parts[i]->a.data(), parts[i]->size());
+        }
+    }
+
+    // r = x * y, r has room for n + m limbs and must not overlap the operands
+    static void multiply(limb* r, const limb* x, size_t n, const limb* y, size_t m) {
+        if (n < m) {
+            std::swap(x, y);
+            std::swap(n, m);
+        }
+        if (m < karatsuba_threshold) {
+            multiply_basecase(r, x, n, y, m);
+        } else if (m >= ntt_threshold) {
+            multiply_ntt(r, x, n, y, m);
+        } else if (2 * m <= n + 1) {
+            std::fill(r, r + n + m, 0);
+            std::vector<limb> part(2 * m);
+            for (size_t i = 0; i < n; i += m) {
+                size_t len = std::min(m, n - i);
+                multiply(part.data(), x + i, len, y, m);
+                add_to(r + i, n + m - i, part.data(), len + m);
+            }
+        } else if (m < toom3_threshold || 3 * m <= 2 * n + 4) {
+            multiply_karatsuba(r, x, n, y, m);
+        } else {
+            multiply_toom3(r, x, n, y, m);
+        }
+    }
+
+    void abs_subtract_small_from_big(const BigInteger& small, bool fl = false) {
+        if (fl) {
+            size_t n = a.size();
+            a.resize(small.size());
+            sub_limbs(a.data(), small.a.data(), small.size(), a.data(), n);
+        } else {
+            sub_limbs(a.data(), a.data(), a.size(), small.a.data(), small.size());
+        }
+        delete_trailing_zeroes(a);
+    }
+
+    static bool less_abs(const BigInteger& lhs, const BigInteger& rhs) {
+        return compare_limbs(lhs.a.data(), lhs.size(), rhs.a.data(), rhs.size()) < 0;
+    }
+
+    static size_t trimmed(const limb* x, size_t n) {
+        while (n > 0 && x[n - 1] == 0) n--;
+        return n;
+    }
+
+    static void trim(std::vector<limb>& x) {
+        x.resize(trimmed(x.data(), x.size()));
+    }
+
+    // r = x << s for 0 <= s < 64, returns the bits shifted out of the top; r may alias x
+    static limb shift_left(limb* r, const limb* x, size_t n, unsigned s) {
+        if (n == 0) return 0;
+        if (s == 0) {
+            std::copy(x, x + n, r);
+            return 0;
+        }
+        limb out = x[n - 1] >> (limb_bits - s);
+        for (size_t i = n - 1; i > 0; i--) {
+            r[i] = (x[i] << s) | (x[i - 1] >> (limb_bits - s));
+        }
+        r[0] = x[0] << s;
+        return out;
+    }
+
+    // r = x >> s for 0 <= s < 64; r may alias x
+    static void shift_right(limb* r, const limb* x, size_t n, unsigned s) {
+        if (n == 0) return;
+        if (s == 0) {
+            std::copy(x, x + n, r);
+            return;
+        }
+        for (size_t i = 0; i + 1 < n; i++) {
+            r[i] = (x[i] >> s) | (x[i + 1] << (limb_bits - s));
+        }
+        r[n - 1] = x[n - 1] >> s;
+    }
+
+    // r -= x * y, returns the limb borrowed from above the top
+    static limb submul_limb(limb* r, const limb* x, size_t n, limb y) {
+        limb borrow = 0;
+        for (size_t i = 0; i < n; i++) {
+            double_limb cur = static_cast<double_limb>(x[i]) * y + borrow;
+            limb low = static_cast<limb>(cur);
+            borrow = static_cast<limb>(cur >> limb_bits) + (r[i] < low);
+            r[i] -= low;
+        }
+        return borrow;
+    }
+
+    // the helpers below work on trimmed limb vectors where zero is the empty vector
+
+    static std::vector<limb> slice(const std::vector<limb>& x, size_t from, size_t len) {
+        if (from >= x.size()) return {};
+        std::vector<limb> result(x.begin() + from, x.begin() + std::min(x.size(), from + len));
+        trim(result);
+        return result;
+    }
+
+    static void shift_limbs(std::vector<limb>& x, size_t k) {
+        if (!x.empty()) x.insert(x.begin(), k, 0);
+    }
+
+    static int compare(const std::vector<limb>& x, const std::vector<limb>& y) {
+        return compare_limbs(x.data(), x.size(), y.data(), y.size());
+    }
+
+    static void add_to(std::vector<limb>& x, const limb* y, size_t m) {
+        m = trimmed(y, m);
+        if (x.size() < m) x.resize(m, 0);
+        limb carry = add_limbs(x.data(), x.data(), x.size(), y, m);
+        if (carry) x.push_back(carry);
+    }
+
+    // requires x >= y
+    static void sub_from(std::vector<limb>& x, const limb* y, size_t m) {
+        sub_limbs(x.data(), x.data(), x.size(), y, trimmed(y, m));
+        trim(x);
+    }
+
+    static void increment(std::vector<limb>& x) {
+        const limb one = 1;
+        add_to(x, &one, 1);
+    }
+
+    static void decrement(std::vector<limb>& x) {
+        const limb one = 1;
+        sub_from(x, &one, 1);
+    }
+
+    static std::vector<limb> product(const std::vector<limb>& x, const std::vector<limb>& y) {
+        if (x.empty() || y.empty()) return {};
+        std::vector<limb> result(x.size() + y.size());
+        multiply(result.data(), x.data(), x.size(), y.data(), y.size());
+        trim(result);
+        return result;
+    }
+
+    // Knuth's algorithm D: q gets n - m + 1 limbs, r gets m limbs, needs n >= m >= 2 and y[m - 1] != 0
+    static void divmod_knuth(limb* q, limb* r, const limb* x, size_t n, const limb* y, size_t m) {
+        unsigned s = __builtin_clzll(y[m - 1]);
+        std::vector<limb> yn(m), xn(n + 1);
+        shift_left(yn.data(), y, m, s);
+        xn[n] = shift_left(xn.data(), x, n, s);
+        const limb top = yn[m - 1], second = yn[m - 2];
+        for (size_t j = n - m + 1; j-- > 0;) {
+            double_limb num = (static_cast<double_limb>(xn[j + m]) << limb_bits) | xn[j + m - 1];
+            double_limb q_hat = num / top;
+            double_limb r_hat = num % top;
+            while ((q_hat >> limb_bits)
+                   || q_hat * second > ((r_hat << limb_bits) | xn[j + m - 2])) {
+                q_hat--;
+                r_hat += top;
+                if (r_hat >> limb_bits) break;
+            }
+            limb borrow = submul_limb(xn.data() + j, yn.data(), m, static_cast<limb>(q_hat));
+            limb high = xn[j + m];
+            xn[j + m] = high - borrow;
+            if (high < borrow) {
+                q_hat--;
+                xn[j + m] += add_limbs(xn.data() + j, xn.data() + j, m, yn.data(), m);
+            }
+            q[j] = static_cast<limb>(q_hat);
+        }
+        shift_right(r, xn.data(), m, s);
+    }
+
+    // quotient of a by an n-limb b, a is replaced by the remainder; any a and b != 0 are accepted
+    static std::vector<limb> divide_basecase(std::vector<limb>& a, const limb* b, size_t n) {
+        n = trimmed(b, n);
+        if (compare_limbs(a.data(), a.size(), b, n) < 0) return {};
+        std::vector<limb> q(a.size() - n + 1);
+        if (n == 1) {
+            limb rem = divmod_limb(q.data(), a.data(), a.size(), b[0]);
+            a.assign(1, rem);
+        } else {
+            std::vector<limb> r(n);
+            divmod_knuth(q.data(), r.data(), a.data(), a.size(), b, n);
+            a = r;
+        }
+        trim(a);
+        trim(q);
+        return q;
+    }
+
+    // Burnikel-Ziegler recursive division: b has n limbs with its top bit set and a < b * B^n,
+    // returns the quotient and leaves the remainder in a
+    static std::vector<limb> divide_2n_1n(std::vector<limb>& a, const limb* b, size_t n) {
+        if (n % 2 == 1 || n < bz_threshold) return divide_basecase(a, b, n);
+        size_t h = n / 2;
+        std::vector<limb> low = slice(a, 0, h);
+        a = slice(a, h, a.size());
+        std::vector<limb> q = divide_3n_2n(a, b, h);
+        shift_limbs(a, h);
+        add_to(a, low.data(), low.size());
+        std::vector<limb> q_low = divide_3n_2n(a, b, h);
+        shift_limbs(q, h);
+        add_to(q, q_low.data(), q_low.size());
+        return q;
+    }
+
+    // b = b1 * B^h + b2 has 2h limbs and a < b * B^h, the quotient has at most h limbs
+    static std::vector<limb> divide_3n_2n(std::vector<limb>& a, const limb* b, size_t h) {
+        const limb* b1 = b + h;
+        std::vector<limb> low = slice(a, 0, h);
+        std::vector<limb> rem = slice(a, h, a.size());
+        std::vector<limb> q;
+        if (compare_limbs(rem.data() + std::min(rem.size(), h), rem.size() - std::min(rem.size(), h), b1, h) < 0) {
+            q = divide_2n_1n(rem, b1, h);
+        } else {
+            q.assign(h, ~limb(0));
+            std::vector<limb> shifted(b1, b1 + h);
+            shift_limbs(shifted, h);
+            sub_from(rem, shifted.data(), shifted.size());
+            add_to(rem, b1, h);
+        }
+        std::vector<limb> d = product(q, std::vector<limb>(b, b + trimmed(b, h)));
+        shift_limbs(rem, h);
+        add_to(rem, low.data(), low.size());
+        while (compare(rem, d) < 0) {
+            decrement(q);
+            add_to(rem, b, 2 * h);
+        }
+        sub_from(rem, d.data(), d.size());
+        a = rem;
+        return q;
+    }
+
+    // floor(B^(2n) / b) for an n-limb b with its top bit set, by Newton iteration from the top half
+    static std::vector<limb> reciprocal(const limb* b, size_t n) {
+        std::vector<limb> power(2 * n + 1, 0);
+        power.back() = 1;
+        if (n < newton_threshold) {
+            std::vector<limb> q, r;
+            divmod_limbs(q, r, power.data(), power.size(), b, n);
+            return q;
+        }
+        size_t h = (n + 1) / 2;
+        std::vector<limb> x = reciprocal(b + n - h, h);
+        shift_limbs(x, n - h);
+        std::vector<limb> divisor(b, b + n);
+        std::vector<limb> p = product(divisor, x);
+        if (compare(p, power) <= 0) {
+            std::vector<limb> e = power;
+            sub_from(e, p.data(), p.size());
+            std::vector<limb> correction = slice(product(x, e), 2 * n, 2 * n + 2);
+            add_to(x, correction.data(), correction.size());
+        } else {
+            sub_from(p, power.data(), power.size());
+            std::vector<limb> correction = slice(product(x, p), 2 * n, 2 * n + 2);
+            increment(correction);
+            sub_from(x, correction.data(), correction.size());
+        }
+        p = product(divisor, x);
+        while (compare(p, power) > 0) {
+            decrement(x);
+            sub_from(p, b, n);
+        }
+        sub_from(power, p.data(), p.size());
+        while (compare(power, divisor) >= 0) {
+            increment(x);
+            sub_from(power, b, n);
+        }
+        return x;
+    }
+
+    // Barrett step with mu = floor(B^(2n) / b): a < b * B^n, returns the quotient and leaves the remainder in a
+    static std::vector<limb> divide_barrett(std::vector<limb>& a, const std::vector<limb>& b, const std::vector<limb>& mu) {
+        size_t n = b.size();
+        std::vector<limb> q = slice(product(slice(a, n - 1, n + 1), mu), n + 1, n + 1);
+        std::vector<limb> qb = product(q, b);
+        sub_from(a, qb.data(), qb.size());
+        while (compare(a, b) >= 0) {
+            sub_from(a, b.data(), b.size());
+            increment(q);
+        }
+        return q;
+    }
+
+    // q = x / y, r = x % y on trimmed magnitudes, y != 0
+    static void divmod_limbs(std::vector<limb>& q, std::vector<limb>& r, const limb* x, size_t n, const limb* y, size_t m) {
+        n = trimmed(x, n);
+        m = trimmed(y, m);
+        r.assign(x, x + n);
+        if (m < bz_threshold || n - std::min(n, m) < bz_threshold) {
+            q = divide_basecase(r, y, m);
+            return;
+        }
+        // shift so that the divisor has its top bit set, and for Burnikel-Ziegler pad it with zero limbs
+        // from below until its length halves evenly down to the basecase
+        // the reciprocal only pays for itself when the quotient spans several divisor-sized blocks
+        bool newton = m >= newton_threshold && n - m >= 2 * m;
+        unsigned s = __builtin_clzll(y[m - 1]);
+        size_t pad = 0;
+        if (!newton) {
+            size_t k = 0;
+            while ((m >> k) >= bz_threshold) k++;
+            size_t block = size_t(1) << k;
+            pad = (m + block - 1) / block * block - m;
+        }
+        size_t len = m + pad;
+        std::vector<limb> b(len, 0), a(n + pad + 1, 0);
+        shift_left(b.data() + pad, y, m, s);
+        a[n + pad] = shift_left(a.data() + pad, x, n, s);
+        trim(a);
+        std::vector<limb> mu;
+        if (newton) mu = reciprocal(b.data(), len);
+        q.clear();
+        r.clear();
+        for (size_t i = (a.size() + len - 1) / len; i-- > 0;) {
+            shift_limbs(r, len);
+            std::vector<limb> block = slice(a, i * len, len);
+            add_to(r, block.data(), block.size());
+            std::vector<limb> q_block = (newton ? divide_barrett(r, b, mu) : divide_2n_1n(r, b.data(), len));
+            shift_limbs(q, len);
+            add_to(q, q_block.data(), q_block.size());
+        }
+        r = slice(r, pad, r.size());
+        shift_right(r.data(), r.data(), r.size(), s);
+        trim(r);
+    }
+
+    // (10^19)^(2^k). Like the NTT tables, a level is built once under the lock and never changes afterwards,
+    // so conversions on any thread may read it without locking
+    static const std::vector<limb>& decimal_power(size_t k) {
+        static std::vector<limb> powers[limb_bits] = {{decimal_base}};
+        static std::atomic<size_t> levels{1};
+        static std::mutex mutex;
+        if (levels.load(std::memory_order_acquire) <= k) {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (size_t i = levels.load(std::memory_order_relaxed); i <= k; i++) {
+                powers[i] = product(powers[i - 1], powers[i - 1]);
+                levels.store(i + 1, std::memory_order_release);
+            }
+        }
+        return powers[k];
+    }
+
+    // writes exactly 19 * 2^k digits of x < (10^19)^(2^k), zero padded from the left
+    static void write_decimal(char* out, const std::vector<limb>& x, size_t k) {
+        size_t width = decimal_base_len << k;
+        if (k == 0 || x.size() < radix_conversion_threshold) {
+            std::vector<limb> cur = x;
+            for (size_t pos = width; pos > 0;) {
+                limb chunk = cur.empty() ? 0 : divmod_limb(cur.data(), cur.data(), cur.size(), decimal_base);
+                trim(cur);
+                for (size_t j = 0; j < decimal_base_len; j++, chunk /= 10) {
+                    out[--pos] = static_cast<char>('0' + chunk % 10);
+                }
+            }
+            return;
+        }
+        std::vector<limb> q, r;
+        const std::vector<limb>& power = decimal_power(k - 1);
+        divmod_limbs(q, r, x.data(), x.size(), power.data(), power.size());
+        write_decimal(out, q, k - 1);
+        write_decimal(out + width / 2, r, k - 1);
+    }
+
+    // writes the digits of x without leading zeros ("0" for zero), returns their count
+    static size_t write_decimal(char* out, const std::vector<limb>& x) {
+        if (x.size() < radix_conversion_threshold) {
+            std::vector<limb> cur = x, chunks;
+            while (!cur.empty()) {
+                chunks.push_back(divmod_limb(cur.data(), cur.data(), cur.size(), decimal_base));
+                trim(cur);
+            }
+            if (chunks.empty()) chunks.push_back(0);
+            size_t len = 0;
+            for (limb top = chunks.back(); len == 0 || top != 0; top /= 10) len++;
+            len += decimal_base_len * (chunks.size() - 1);
+            size_t pos = len;
+            for (size_t i = 0; i < chunks.size(); i++) {
+                limb chunk = chunks[i];
+                for (size_t j = 0; j < decimal_base_len && pos > 0; j++, chunk /= 10) {
+                    out[--pos] = static_cast<char>('0' + chunk % 10);
+                }
+            }
+            return len;
+        }
+        size_t k = 0;
+        while (compare(decimal_power(k + 1), x) <= 0) k++;
+        std::vector<limb> q, r;
+        const std::vector<limb>& power = decimal_power(k);
+        divmod_limbs(q, r, x.data(), x.size(), power.data(), power.size());
+        size_t len = write_decimal(out, q);
+        write_decimal(out + len, r, k);
+        return len + (decimal_base_len << k);
+    }
+
+    // 10^p
+    static std::vector<limb> power_of_ten(size_t p) {
+        limb small = 1;
+        for (size_t i = 0; i < p % decimal_base_len; i++) small *= 10;
+        std::vector<limb> result = {small};
+        for (size_t k = 0; (p / decimal_base_len) >> k; k++) {
+            if (((p / decimal_base_len) >> k) & 1) result = product(result, decimal_power(k));
+        }
+        return result;
+    }
+
+    size_t bit_length() const {
+        return is_zero() ? 0 : a.size() * limb_bits - __builtin_clzll(a[a.size() - 1]);
+    }
+
+    // the top 128 bits of the nonzero magnitude shifted so that the highest one is bit 127,
+    // cut tells whether any nonzero bits were dropped below them
+    double_limb leading_bits(bool& cut) const {
+        size_t n = a.size();
+        unsigned s = __builtin_clzll(a[n - 1]);
+        limb low = n > 2 ? a[n - 3] : 0;
+        double_limb top = (static_cast<double_limb>(a[n - 1]) << limb_bits) | (n > 1 ? a[n - 2] : 0);
+        if (s != 0) top = (top << s) | (low >> (limb_bits - s));
+        cut = (low << s) != 0;
+        for (size_t i = 0; i + 3 < n && !cut; i++) cut = a[i] != 0;
+        return top;
+    }
+
+    // x * 2^exponent rounded to the nearest double, ties to even, for x >= 2^63; sticky tells that
+    // the exact value lies strictly between x and x + 1 units
+    static double round_to_double(double_limb x, long long exponent, bool sticky) {
+        limb high = static_cast<limb>(x >> limb_bits);
+        long long bits = high != 0 ? 2 * limb_bits - __builtin_clzll(high) : limb_bits;
+        long long top = bits - 1 + exponent;
+        if (top > 1023) return HUGE_VAL;
+        // subnormals keep fewer bits, everything below half of the least one rounds to zero
+        long long shift = bits - std::min(53ll, top + 1075);
+        if (shift > bits) return 0.0;
+        double_limb kept = shift == bits ? 0 : x >> shift;
+        double_limb rest = x - (kept << shift), half = static_cast<double_limb>(1) << (shift - 1);
+        if (rest > half || (rest == half && (sticky || (kept & 1)))) kept++;
+        return std::ldexp(static_cast<double>(kept), static_cast<int>(exponent + shift));
+    }
+
+    // |n| / |d| correctly rounded: the top limbs usually pin the result down, otherwise
+    // a quotient with a sticky bit is computed exactly
+    static double quotient_to_double(const BigInteger& n, const BigInteger& d) {
+        if (n.is_zero()) return 0.0;
+        long long n_bits = n.bit_length(), d_bits = d.bit_length();
+        // the quotient of the top bits is at least 2^63, far outside the double range it is inf or zero anyway
+        long long exponent = std::max(-4000ll, std::min(4000ll, (n_bits - 128) - (d_bits - 64)));
+        bool n_cut, d_cut;
+        double_limb top_n = n.leading_bits(n_cut), top_d = d.leading_bits(d_cut);
+        d_cut |= static_cast<limb>(top_d) != 0;
+        top_d >>= limb_bits;
+        if (!n_cut && !d_cut) return round_to_double(top_n / top_d, exponent, top_n % top_d != 0);
+        double low = round_to_double(top_n / (top_d + d_cut), exponent, false);
+        double high = round_to_double(top_n / top_d + 1, exponent, false);
+        if (low == high) return low;
+        long long s = 65 + d_bits - n_bits;
+        std::vector<limb> x(n.a.begin(), n.a.end()), y(d.a.begin(), d.a.end());
+        std::vector<limb>& shifted = s >= 0 ? x : y;
+        size_t shift = static_cast<size_t>(s >= 0 ? s : -s);
+        shifted.insert(shifted.begin(), shift / limb_bits, 0);
+        shifted.push_back(0);
+        shift_left(shifted.data(), shifted.data(), shifted.size(), shift % limb_bits);
+        std::vector<limb> q, r;
+        divmod_limbs(q, r, x.data(), x.size(), y.data(), y.size());
+        double_limb quotient = (static_cast<double_limb>(q.size() > 1 ? q[1] : 0) << limb_bits) | q[0];
+        return round_to_double(quotient, -s, trimmed(r.data(), r.size()) != 0);
+    }
+
+    static std::vector<limb> parse_decimal(const char* s, size_t len) {
+        if (len <= decimal_base_len * radix_conversion_threshold) {
+            std::vector<limb> result;
+            size_t chunk = len % decimal_base_len;
+            if (chunk == 0) chunk = decimal_base_len;
+            for (size_t cur = 0; cur < len; cur += chunk, chunk = decimal_base_len) {
+                limb number = 0;
+                for (size_t j = cur; j < cur + chunk; j++) {
+                    number = number * 10 + (s[j] - '0');
+                }
+                limb carry = mul_limb(result.data(), result.data(), result.size(), decimal_base);
+                if (carry) result.push_back(carry);
+                add_to(result, &number, 1);
+            }
+            trim(result);
+            return result;
+        }
+        size_t k = 0;
+        while ((decimal_base_len << (k + 1)) < len) k++;
+        size_t low_len = decimal_base_len << k;
+        std::vector<limb> result = product(parse_decimal(s, len - low_len), decimal_power(k));
+        std::vector<limb> low = parse_decimal(s + len - low_len, low_len);
+        add_to(result, low.data(), low.size());
+        return result;
+    }
+
+    static limb binary_gcd(limb x, limb y) {
+        if (x == 0 || y == 0) return x | y;
+        unsigned shift = __builtin_ctzll(x | y);
+        x >>= __builtin_ctzll(x);
+        while (y) {
+            y >>= __builtin_ctzll(y);
+            if (x > y) std::swap(x, y);
+            y -= x;
+        }
+        return x << shift;
+    }
+
+    static double_limb binary_gcd(double_limb x, double_limb y) {
+        if (x == 0 || y == 0) return x | y;
+        unsigned shift = trailing_zeros(x | y);
+        x >>= trailing_zeros(x);
+        while (y) {
+            y >>= trailing_zeros(y);
+            if (x > y) std::swap(x, y);
+            y -= x;
+        }
+        return x << shift;
+    }
+
+    static unsigned trailing_zeros(double_limb x) {
+        limb low = static_cast<limb>(x);
+        return low ? __builtin_ctzll(low) : limb_bits + __builtin_ctzll(static_cast<limb>(x >> limb_bits));
+    }
+
+    // the magnitude of a number of at most two limbs
+    static double_limb two_limb_value(const BigInteger& x) {
+        double_limb value = x[0];
+        if (x.size() == 2) value |= static_cast<double_limb>(x[1]) << limb_bits;
+        return value;
+    }
+
+    static BigInteger from_two_limbs(double_limb x) {
+        BigInteger result;
+        result.a[0] = static_cast<limb>(x);
+        if (x >> limb_bits) result.a.push_back(static_cast<limb>(x >> limb_bits));
+        return result;
+    }
+
+    static BigInteger mul_small(const BigInteger& x, int64_t p) {
+        BigInteger result = x;
+        limb carry = mul_limb(result.a.data(), result.a.data(), result.size(), p < 0 ? limb(0) - limb(p) : limb(p));
+        if (carry) result.a.push_back(carry);
+        delete_trailing_zeroes(result.a);
+        if (p < 0) result.sign = result.sign * Sign::minus;
+        if (result.is_zero()) result.sign = Sign::plus;
+        return result;
+    }
+
+    // bits [shift, shift + 64) of x
+    static limb bits_at(const BigInteger& x, size_t shift) {
+        size_t i = shift / limb_bits, offset = shift % limb_bits;
+        if (i >= x.size()) return 0;
+        limb result = x[i] >> offset;
+        if (offset && i + 1 < x.size()) result |= x[i + 1] << (limb_bits - offset);
+        return result;
     }
-    
-    static void reverse(std::string& s) {
-        if (s.size() == 0) return;
-        for (size_t curl = 0, curr = s.size() - 1; curl < curr; curl++, curr--) {
-            std::swap(s[curl], s[curr]);
+
+    // (a, b) := (p a + q b, r a + s b) and the same for the rows of the cofactor matrix m when it is tracked
+    static void apply_step(BigInteger& a, BigInteger& b, int64_t p, int64_t q, int64_t r, int64_t s, BigInteger* m) {
+        BigInteger new_a = mul_small(a, p);
+        new_a += mul_small(b, q);
+        b = mul_small(a, r) += mul_small(b, s);
+        a = new_a;
+        if (m) {
+            for (size_t j = 0; j < 2; j++) {
+                BigInteger top = mul_small(m[j], p);
+                top += mul_small(m[2 + j], q);
+                m[2 + j] = mul_small(m[j], r) += mul_small(m[2 + j], s);
+                m[j] = top;
+            }
         }
     }
 
-    static void delete_trailing_zeroes(std::string& s) {
-        reverse(s);
-        while (s.size() > 1 && s.back() == '0') s.pop_back();
-        reverse(s);
+    // one Lehmer step (Knuth's algorithm L) driven by the leading 62 bits of a >= b > 0; returns false
+    // when those bits do not determine a single quotient and a full division step is needed instead
+    static bool lehmer_step(BigInteger& a, BigInteger& b, BigInteger* m) {
+        size_t bits = (a.size() - 1) * limb_bits + limb_bits - __builtin_clzll(a.a.back());
+        size_t shift = bits > 62 ? bits - 62 : 0;
+        int64_t x = static_cast<int64_t>(bits_at(a, shift)), y = static_cast<int64_t>(bits_at(b, shift));
+        int64_t p = 1, q = 0, r = 0, s = 1;
+        while (y + r != 0 && y + s != 0) {
+            int64_t quotient = (x + p) / (y + r);
+            if (quotient != (x + q) / (y + s)) break;
+            int64_t t = p - quotient * r;
+            p = r;
+            r = t;
+            t = q - quotient * s;
+            q = s;
+            s = t;
+            t = x - quotient * y;
+            x = y;
+            y = t;
+        }
+        if (q == 0) return false;
+        apply_step(a, b, p, q, r, s, m);
+        return true;
     }
 
-    static void delete_trailing_zeroes(std::vector<int>& x) {
-        while (x.size() > 1 && x.back() == 0) x.pop_back();
+    static void division_step(BigInteger& a, BigInteger& b, BigInteger* m) {
+        BigInteger quotient, remainder;
+        divmod(a, b, quotient, remainder);
+        a = b;
+        b = remainder;
+        if (m) {
+            for (size_t j = 0; j < 2; j++) {
+                BigInteger next = m[2 + j];
+                next *= quotient;
+                next -= m[j];
+                m[j] = m[2 + j];
+                m[2 + j] = -next;
+            }
+        }
     }
 
-    static Sign sgn(int x) {
-        return static_cast<Sign>((0 <= x) - (x < 0));
+    // p * x + q * y
+    static BigInteger combine(const BigInteger& p, const BigInteger& x, const BigInteger& q, const BigInteger& y) {
+        BigInteger result = p, second = q;
+        result *= x;
+        second *= y;
+        result += second;
+        return result;
     }
 
-    static void FFT(std::vector<std::complex<double>>& a, bool invert) {
-        int n = a.size();
-        for (int i = 1, j = 0; i < n - 1; i++) {
-            for (int s = n; j ^= s >>= 1, ~j&  s;);
-            if (i < j) swap(a[i], a[j]);
-        }
-        for (int len = 2; len <= n; len <<= 1) {
-            double angle = 2 * PI / len * (invert ? -1 : 1);
-            std::complex<double> wlen(cos(angle), sin(angle)), w, u, v;
-            for (int i = 0; i < n; i += len) {
-                w = 1;
-                for (int j = 0; j < len / 2; j++) {
-                    u = a[i + j], v = a[i + j + len / 2] * w;
-                    a[i + j] = u + v;
-                    a[i + j + len / 2] = u - v;
-                    w *= wlen;
-                }
+    // (a, b) := t (a, b) and m := t m, then signs and order are restored so that a >= b >= 0;
+    // t is unimodular, so the gcd is preserved even when the top limbs it came from mispredicted a quotient
+    static void apply_cofactors(BigInteger& a, BigInteger& b, BigInteger* t, BigInteger* m) {
+        BigInteger new_a = combine(t[0], a, t[1], b);
+        b = combine(t[2], a, t[3], b);
+        a = new_a;
+        for (size_t i = 0; i < 2; i++) {
+            BigInteger& x = (i == 0 ? a : b);
+            if (x.sign == Sign::minus) {
+                x.sign = Sign::plus;
+                t[2 * i] = -t[2 * i];
+                t[2 * i + 1] = -t[2 * i + 1];
             }
         }
-        if (invert) {
-            for (int i = 0; i < n; ++i) {
-                a[i] /= n;
+        if (less_abs(a, b)) {
+            std::swap(a, b);
+            std::swap(t[0], t[2]);
+            std::swap(t[1], t[3]);
+        }
+        if (m) {
+            for (size_t j = 0; j < 2; j++) {
+                BigInteger top = combine(t[0], m[j], t[1], m[2 + j]);
+                m[2 + j] = combine(t[2], m[j], t[3], m[2 + j]);
+                m[j] = top;
             }
         }
     }
 
-    void abs_subtract_small_from_big(const BigInteger& small, bool fl = false) {
-        size_t len_small = small.size();
-        size_t len_big = a.size();
-        if (fl) std::swap(len_small, len_big);
-        a.resize(len_big, 0);
-        int sign_fl = (fl ? -1 : 1);
-        for (size_t i = 0; i < small.size(); i++) {
-            a[i] -= small[i];
-            a[i] *= sign_fl;
-        }
-        int subtract = 0;
-        for (size_t i = 0; i < len_big; i++) {
-            a[i] -= subtract;
-            subtract = 0;
-            if (a[i] < 0) {
-                a[i] += base;
-                subtract = 1;
+    // runs the remainder sequence of a >= b >= 0 until a has at most stop limbs or b vanishes, accumulating
+    // the 2x2 cofactor matrix into m when it is not null; large inputs reduce their top 2h limbs by h limbs
+    // recursively (half-gcd) and apply the resulting matrix with fast multiplication
+    static void gcd_reduce(BigInteger& a, BigInteger& b, size_t stop, BigInteger* m) {
+        while (a.size() > stop && !b.is_zero()) {
+            size_t n = a.size();
+            if (!m && b.size() == 1) {
+                limb rem = divmod_limb(a.a.data(), a.a.data(), n, b[0]);
+                a.a.assign(1, binary_gcd(b[0], rem));
+                b.a.assign(1, 0);
+                return;
             }
+            size_t h = std::min(n - stop, n / 2) / 2;
+            if (h >= hgcd_threshold && b.size() > n - h) {
+                size_t k = n - 2 * h;
+                BigInteger top_a = from_limbs(a.a.data() + k, n - k), top_b = from_limbs(b.a.data() + k, b.size() - k);
+                BigInteger t[4] = {1, 0, 0, 1};
+                gcd_reduce(top_a, top_b, h, t);
+                apply_cofactors(a, b, t, m);
+                if (a.size() < n || b.is_zero()) continue;
+            } else if (b.size() + 1 >= n && lehmer_step(a, b, m)) {
+                continue;
+            }
+            division_step(a, b, m);
         }
-        delete_trailing_zeroes(a);
     }
 
-    static bool less_abs(const BigInteger& lhs, const BigInteger& rhs) {
-        if (lhs.size() != rhs.size()) return (lhs.size() < rhs.size());
-        for (int i = lhs.size() - 1; i >= 0; i--) {
-            if (lhs[i] != rhs[i]) return (lhs[i] < rhs[i]);
+    void add_with_sign(const BigInteger& x, Sign mul_sign) {
+        Sign lhs_sign = sign;
+        Sign rhs_sign = x.sign * mul_sign;
+        if (a.size() == 1 && x.size() == 1) {
+            limb y = x[0];
+            if (lhs_sign == rhs_sign) {
+                a[0] += y;
+                if (a[0] < y) a.push_back(1);
+            } else if (a[0] >= y) {
+                a[0] -= y;
+                if (a[0] == 0) sign = Sign::plus;
+            } else {
+                a[0] = y - a[0];
+                sign = rhs_sign;
+            }
+            return;
+        }
+        if (lhs_sign == rhs_sign) {
+            if (a.size() < x.size()) a.resize(x.size(), 0);
+            limb carry = add_limbs(a.data(), a.data(), a.size(), x.a.data(), x.size());
+            if (carry) a.push_back(carry);
+            sign = lhs_sign;
+        } else {
+            if (less_abs(*this, x)) {
+                abs_subtract_small_from_big(x, true);
+                sign = rhs_sign;
+            } else {
+                abs_subtract_small_from_big(x, false);
+                sign = lhs_sign;
+            }
+            if (is_zero()) sign = Sign::plus;
         }
-        return false;
     }
 
-    static void div10(BigInteger& x) {
-        int add = 0;
-        for (int i = x.size() - 1; i >= 0; i--) {
-            int cur = x[i] + add * base;
-            x[i] = cur / 10;
-            add = cur % 10;
+    // r = x * y for r distinct from x and y, allocating the result once
+    static void multiply(BigInteger& r, const BigInteger& x, const BigInteger& y) {
+        r.a.resize(x.size() + y.size());
+        multiply(r.a.data(), x.a.data(), x.size(), y.a.data(), y.size());
+        delete_trailing_zeroes(r.a);
+        r.sign = x.sign * y.sign;
+        if (r.is_zero()) r.sign = Sign::plus;
+    }
+
+    // *this = *this / x with the remainder stored in rem when it is requested, truncating towards zero
+    void divide(const BigInteger& x, BigInteger* rem) {
+        Sign rem_sign = sign;
+        if (x.size() == 1) {
+            limb r = divmod_limb(a.data(), a.data(), a.size(), x[0]);
+            delete_trailing_zeroes(a);
+            sign = sign * x.sign;
+            if (is_zero()) sign = Sign::plus;
+            if (rem) {
+                rem->a.assign(1, r);
+                rem->sign = r == 0 ? Sign::plus : rem_sign;
+            }
+            return;
+        }
+        std::vector<limb> q, r;
+        divmod_limbs(q, r, a.data(), a.size(), x.a.data(), x.size());
+        if (q.empty()) q.push_back(0);
+        if (r.empty()) r.push_back(0);
+        a = q;
+        sign = sign * x.sign;
+        if (is_zero()) sign = Sign::plus;
+        if (rem) {
+            rem->a = r;
+            rem->sign = rem->is_zero() ? Sign::plus : rem_sign;
         }
-        delete_trailing_zeroes(x.a);
     }
 
 public:
     BigInteger() : a({0}), sign(Sign::plus) {}
 
-    BigInteger(const std::string& s) {
-        a.clear();
-        sign = Sign::plus;
-        int cur = 0;
-        if (s[cur] == '-') {
+    BigInteger(const std::string& s) : sign(Sign::plus) {
+        size_t cur = 0;
+        if (cur < s.size() && s[cur] == '-') {
             sign = Sign::minus;
             cur++;
         }
-        for (int i = s.size() - 1; i >= cur; i -= base_len) {
-            int number = 0;
-            for (int j = std::max(cur, static_cast<int>(i - base_len + 1)); j <= i; j++) {
-                number *= 10;
-                number += s[j] - '0';
-            }
-            a.push_back(number);
-        }
-        delete_trailing_zeroes(a);
+        a = parse_decimal(s.data() + cur, s.size() - cur);
+        if (a.empty()) a.push_back(0);
+        if (is_zero()) sign = Sign::plus;
     }
 
-    BigInteger(int x) : sign(sgn(x)) {
-        x = abs(x);
-        do {
-            a.push_back(x % base);
-            x /= base;
-        } while (x > 0);
-    }
+    BigInteger(int x) : a({x < 0 ? limb(0) - static_cast<limb>(x) : static_cast<limb>(x)}), sign(sgn(x)) {}
 
     BigInteger(const BigInteger& x) : a(x.a), sign(x.sign) {}
 
+    BigInteger(BigInteger&& x) noexcept : a(std::move(x.a)), sign(x.sign) {
+        x.a.assign(1, 0);
+        x.sign = Sign::plus;
+    }
+
     BigInteger& operator=(const BigInteger& x) {
         a = x.a;
         sign = x.sign;
         return *this;
     }
 
+    BigInteger& operator=(BigInteger&& x) noexcept {
+        if (this == &x) return *this;
+        a = std::move(x.a);
+        sign = x.sign;
+        x.a.assign(1, 0);
+        x.sign = Sign::plus;
+        return *this;
+    }
+
     std::string toString() const {
-        std::string res;
-        for (size_t i = a.size() - 1; ; i--) {
-            res += number_to_string(a[i]);
-            if (i == 0) break;
-        }
-        delete_trailing_zeroes(res);
-        if (sign == Sign::minus) res = "-" + res;
+        std::vector<limb> x(a.begin(), a.end());
+        trim(x);
+        size_t k = 0;
+        while (compare(decimal_power(k), x) <= 0) k++;
+        size_t start = (sign == Sign::minus);
+        std::string res(start + (decimal_base_len << k), '-');
+        write_decimal(&res[start], x, k);
+        size_t first = start;
+        while (first + 1 < res.size() && res[first] == '0') first++;
+        res.erase(start, first - start);
         return res;
     }
 
     BigInteger& operator*=(const BigInteger& x) {
-        std::vector<std::complex<double>> fa(a.begin(), a.end());
-        std::vector<std::complex<double>> fb(x.a.begin(), x.a.end());
-        size_t n = 1;
-        while (n < std::max(a.size(), x.a.size())) n <<= 1;
-        n <<= 1;
-        fa.resize(n);
-        fb.resize(n);
-        FFT(fa, false);
-        FFT(fb, false);
-        for (size_t i = 0; i < n; ++i) {
-            fa[i] *= fb[i];
-        }
-        FFT(fa, true);
-        std::vector<int> res(n);
-        for (size_t i = 0; i < n; ++i) {
-            res[i] = static_cast<int>(fa[i].real() + 0.5);
-        }
-        int add = 0;
-        for (size_t i = 0; i < n; i++) {
-            res[i] += add;
-            add = res[i] / base;
-            res[i] %= base;
+        if (a.size() == 1 && x.size() == 1) {
+            double_limb product = static_cast<double_limb>(a[0]) * x[0];
+            a[0] = static_cast<limb>(product);
+            if (product >> limb_bits) a.push_back(static_cast<limb>(product >> limb_bits));
+            sign = sign * x.sign;
+            if (is_zero()) sign = Sign::plus;
+            return *this;
         }
-        delete_trailing_zeroes(res);
-        sign = sign * x.sign;
-        a = res;
-        if (is_zero()) sign = Sign::plus;
+        if (x.size() == 1) {
+            limb carry = mul_limb(a.data(), a.data(), a.size(), x[0]);
+            if (carry) a.push_back(carry);
+            delete_trailing_zeroes(a);
+            sign = sign * x.sign;
+            if (is_zero()) sign = Sign::plus;
+            return *this;
+        }
+        BigInteger result;
+        multiply(result, *this, x);
+        *this = std::move(result);
         return *this;
     }
     
     BigInteger& operator+=(const BigInteger& x) {
-        Sign lhs_sign = sign;
-        Sign rhs_sign = x.sign;
-        if (lhs_sign == rhs_sign) {
-            int add = 0;
-            size_t len = std::max(a.size(), x.size());
-            a.resize(len, 0);
-            for (size_t i = 0; i < len; i++) {
-                a[i] = a[i] + (i < x.size() ? x[i] : 0) + add;
-                add = a[i] / base;
-                a[i] %= base;
-            }
-            a.push_back(add);
-            sign = lhs_sign;
-        } else {
-            if (less_abs(*this, x)) {
-                abs_subtract_small_from_big(x, true);
-                sign = rhs_sign;
-            } else {
-                abs_subtract_small_from_big(x, false);
-                sign = lhs_sign;
-            }
-            if (is_zero()) sign = Sign::plus;
-        }
-        delete_trailing_zeroes(a);
+        add_with_sign(x, Sign::plus);
         return *this;
     }
 
     BigInteger& operator/=(const BigInteger& x) {
-        if (x.size() > a.size()) {
-            a = {0};
-            sign = Sign::plus;
-            return *this;
-        }
-        BigInteger x_abs = x;
-        x_abs.sign = Sign::plus;
-        std::string divisor = x_abs.toString();
-        std::string result;
-        sign = sign * x.sign;
-        if (sign == Sign::minus) result += '-';
-        sign = Sign::plus;
-        int degree = (a.size() - x.size() + 1) * base_len;
-        divisor += std::string(degree, '0');
-        BigInteger sub = divisor;
-        for (; degree >= 0; degree--) {
-            int number = 0;
-            for (; number < 9; number++) {
-                if (less_abs(*this, sub)) break;
-                *this -= sub;
-            }
-            result += char('0' + number);
-            div10(sub);
-        }
-        *this = result;
-        delete_trailing_zeroes(a);
-        if (is_zero()) sign = Sign::plus;
+        divide(x, nullptr);
         return *this;
     }
 
     BigInteger& operator%=(const BigInteger& x) {
-        BigInteger copy = *this;
-        copy /= x;
-        copy *= x;
-        *this -= copy;
-        if (is_zero()) sign = Sign::plus;
+        BigInteger quotient = *this;
+        quotient.divide(x, this);
         return *this;
     }
 
+    friend void divmod(const BigInteger& x, const BigInteger& y, BigInteger& quotient, BigInteger& remainder);
+
+    friend BigInteger gcd(const BigInteger& x, const BigInteger& y);
+
+    friend BigInteger gcdex(const BigInteger& x, const BigInteger& y, BigInteger& u, BigInteger& v);
+
+    friend BigInteger operator*(const BigInteger& lhs, const BigInteger& rhs);
+
+    friend void fma(BigInteger& acc, const BigInteger& x, const BigInteger& y);
+
+    template <typename T>
+    friend class ProductSum;
+
+    friend class Rational;
+
     BigInteger& operator-=(const BigInteger& x) {
-        BigInteger copy = x;
-        copy.sign = copy.sign * Sign::minus;
-        *this += copy;
+        add_with_sign(x, Sign::minus);
         return *this;
     }
 
@@ -292,21 +1493,26 @@ public:
         return copy;
     }
 
-    BigInteger operator-() const {
+    BigInteger operator-() const& {
         BigInteger copy = *this;
         if (!copy.is_zero()) copy.sign = copy.sign * Sign::minus;
         return copy;
     }
 
+    BigInteger operator-() && {
+        if (!is_zero()) sign = sign * Sign::minus;
+        return std::move(*this);
+    }
+
     explicit operator bool() const {
         return !(is_zero());
     }
 
-    int& operator[](size_t i) {
+    uint64_t& operator[](size_t i) {
         return a[i];
     }
 
-    const int& operator[](size_t i) const {
+    const uint64_t& operator[](size_t i) const {
         return a[i];
     }
 
@@ -331,16 +1537,42 @@ public:
     }
 };
 
-BigInteger gcd(BigInteger a, BigInteger b) {
-    while (b) {
-        a %= b;
-        std::swap(a, b);
+inline void divmod(const BigInteger& x, const BigInteger& y, BigInteger& quotient, BigInteger& remainder) {
+    BigInteger result = x;
+    result.divide(y, &remainder);
+    quotient = std::move(result);
+}
+
+inline BigInteger gcd(const BigInteger& x, const BigInteger& y) {
+    BigInteger a = x, b = y;
+    a.sign = b.sign = Sign::plus;
+    if (BigInteger::less_abs(a, b)) std::swap(a, b);
+    if (a.size() == 1) return BigInteger::from_two_limbs(BigInteger::binary_gcd(a[0], b[0]));
+    if (a.size() == 2) {
+        return BigInteger::from_two_limbs(BigInteger::binary_gcd(BigInteger::two_limb_value(a), BigInteger::two_limb_value(b)));
     }
+    BigInteger::gcd_reduce(a, b, 0, nullptr);
+    return a;
+}
+
+// returns gcd(x, y) >= 0 and sets u, v so that x * u + y * v equals it
+inline BigInteger gcdex(const BigInteger& x, const BigInteger& y, BigInteger& u, BigInteger& v) {
+    BigInteger a = x, b = y;
+    a.sign = b.sign = Sign::plus;
+    bool swapped = BigInteger::less_abs(a, b);
+    if (swapped) std::swap(a, b);
+    BigInteger m[4] = {1, 0, 0, 1};
+    BigInteger::gcd_reduce(a, b, 0, m);
+    u = m[swapped ? 1 : 0];
+    v = m[swapped ? 0 : 1];
+    if (x.get_sign() == Sign::minus) u = -u;
+    if (y.get_sign() == Sign::minus) v = -v;
     return a;
 }
 
-bool operator==(const BigInteger& lhs, const BigInteger& rhs) {
+inline bool operator==(const BigInteger& lhs, const BigInteger& rhs) {
     if (lhs.get_sign() != rhs.get_sign()) return false;
+    if (lhs.size() == 1 && rhs.size() == 1) return lhs[0] == rhs[0];
     if (lhs.size() != rhs.size()) return false;
     for (size_t i = 0; i < lhs.size(); i++) {
         if (lhs[i] != rhs[i]) return false;
@@ -348,12 +1580,13 @@ bool operator==(const BigInteger& lhs, const BigInteger& rhs) {
     return true;
 }
 
-bool operator!=(const BigInteger& lhs, const BigInteger& rhs) {
+inline bool operator!=(const BigInteger& lhs, const BigInteger& rhs) {
     return !(lhs == rhs);
 }
 
-bool operator<(const BigInteger& lhs, const BigInteger& rhs) {
+inline bool operator<(const BigInteger& lhs, const BigInteger& rhs) {
     if (lhs.get_sign() != rhs.get_sign()) return lhs.get_sign() < rhs.get_sign();
+    if (lhs.size() == 1 && rhs.size() == 1) return lhs.get_sign() == Sign::minus ? rhs[0] < lhs[0] : lhs[0] < rhs[0];
     if (lhs.size() != rhs.size()) return (lhs.get_sign() == Sign::minus) ^ (lhs.size() < rhs.size());
     for (int i = lhs.size() - 1; i >= 0; i--) {
         if (lhs[i] != rhs[i]) return (lhs.get_sign() == Sign::minus) ^ (lhs[i] < rhs[i]);
@@ -361,60 +1594,224 @@ bool operator<(const BigInteger& lhs, const BigInteger& rhs) {
     return false;
 }
 
-bool operator>(const BigInteger& lhs, const BigInteger& rhs) {
+inline bool operator>(const BigInteger& lhs, const BigInteger& rhs) {
     return rhs < lhs;
 }
 
-bool operator<=(const BigInteger& lhs, const BigInteger& rhs) {
+inline bool operator<=(const BigInteger& lhs, const BigInteger& rhs) {
     return !(rhs < lhs);
 }
 
-bool operator>=(const BigInteger& lhs, const BigInteger& rhs) {
+inline bool operator>=(const BigInteger& lhs, const BigInteger& rhs) {
     return !(lhs < rhs);
 }
 
-BigInteger operator*(const BigInteger& lhs, const BigInteger& rhs) {
-    BigInteger copy = lhs;
-    copy *= rhs;
-    return copy;
+inline BigInteger operator*(const BigInteger& lhs, const BigInteger& rhs) {
+    BigInteger result;
+    BigInteger::multiply(result, lhs, rhs);
+    return result;
+}
+
+inline BigInteger operator*(BigInteger&& lhs, const BigInteger& rhs) {
+    lhs *= rhs;
+    return std::move(lhs);
+}
+
+inline BigInteger operator*(const BigInteger& lhs, BigInteger&& rhs) {
+    rhs *= lhs;
+    return std::move(rhs);
+}
+
+inline BigInteger operator*(BigInteger&& lhs, BigInteger&& rhs) {
+    lhs *= rhs;
+    return std::move(lhs);
 }
 
-BigInteger operator+(const BigInteger& lhs, const BigInteger& rhs) {
+inline BigInteger operator+(const BigInteger& lhs, const BigInteger& rhs) {
     BigInteger copy = lhs;
     copy += rhs;
     return copy;
 }
 
-BigInteger operator-(const BigInteger& lhs, const BigInteger& rhs) {
+inline BigInteger operator+(BigInteger&& lhs, const BigInteger& rhs) {
+    lhs += rhs;
+    return std::move(lhs);
+}
+
+inline BigInteger operator+(const BigInteger& lhs, BigInteger&& rhs) {
+    rhs += lhs;
+    return std::move(rhs);
+}
+
+// the sum goes into the longer operand, whose storage is more likely to have room for it
+inline BigInteger operator+(BigInteger&& lhs, BigInteger&& rhs) {
+    if (lhs.size() < rhs.size()) return std::move(rhs += lhs);
+    return std::move(lhs += rhs);
+}
+
+inline BigInteger operator-(const BigInteger& lhs, const BigInteger& rhs) {
     BigInteger copy = lhs;
     copy -= rhs;
     return copy;
 }
 
-BigInteger operator/(const BigInteger& lhs, const BigInteger& rhs) {
+inline BigInteger operator-(BigInteger&& lhs, const BigInteger& rhs) {
+    lhs -= rhs;
+    return std::move(lhs);
+}
+
+inline BigInteger operator-(const BigInteger& lhs, BigInteger&& rhs) {
+    rhs -= lhs;
+    return -std::move(rhs);
+}
+
+inline BigInteger operator-(BigInteger&& lhs, BigInteger&& rhs) {
+    lhs -= rhs;
+    return std::move(lhs);
+}
+
+inline BigInteger operator/(const BigInteger& lhs, const BigInteger& rhs) {
     BigInteger copy = lhs;
     copy /= rhs;
     return copy;
 }
 
-BigInteger operator%(const BigInteger& lhs, const BigInteger& rhs) {
+inline BigInteger operator/(BigInteger&& lhs, const BigInteger& rhs) {
+    lhs /= rhs;
+    return std::move(lhs);
+}
+
+inline BigInteger operator%(const BigInteger& lhs, const BigInteger& rhs) {
     BigInteger copy = lhs;
     copy %= rhs;
     return copy;
 }
 
-std::ostream& operator<<(std::ostream& out, const BigInteger& a) {
+inline BigInteger operator%(BigInteger&& lhs, const BigInteger& rhs) {
+    lhs %= rhs;
+    return std::move(lhs);
+}
+
+inline std::ostream& operator<<(std::ostream& out, const BigInteger& a) {
     out << a.toString();
     return out;
 }
 
-std::istream& operator>>(std::istream& in, BigInteger& a) {
+inline std::istream& operator>>(std::istream& in, BigInteger& a) {
     std::string s;
     in >> s;
     a = s;
     return in;
 }
 
+// acc += x * y, accumulating short products straight into acc instead of building a temporary
+inline void fma(BigInteger& acc, const BigInteger& x, const BigInteger& y) {
+    Sign product_sign = x.sign * y.sign;
+    size_t n = x.size(), m = y.size();
+    // the limbs of acc are written while those of x and y are read, so an aliased operand takes the product first
+    if (&acc == &x || &acc == &y || (acc.sign != product_sign && !acc.is_zero()) ||
+        std::min(n, m) >= BigInteger::karatsuba_threshold) {
+        acc += x * y;
+        return;
+    }
+    if (x.is_zero() || y.is_zero()) return;
+    acc.sign = product_sign;
+    acc.a.resize(std::max(acc.size(), n + m) + 1, 0);
+    for (size_t j = 0; j < m; j++) {
+        uint64_t carry = BigInteger::addmul_limb(acc.a.data() + j, x.a.data(), n, y[j]);
+        for (size_t k = j + n; carry; k++) {
+            acc.a[k] += carry;
+            carry = (acc.a[k] < carry);
+        }
+    }
+    BigInteger::delete_trailing_zeroes(acc.a);
+}
+
+// accumulates a sum of products, specialized for BigInteger and Rational to defer carries and normalization
+template <typename T>
+class ProductSum {
+private:
+    T sum = 0;
+
+public:
+    void add(const T& x, const T& y) {
+        sum += x * y;
+    }
+
+    T value() const {
+        return sum;
+    }
+};
+
+// positive and negative products are summed column by column into 128-bit counters with an overflow limb,
+// the carries are propagated once, when the value is read
+template <>
+class ProductSum<BigInteger> {
+private:
+    using limb = uint64_t;
+    using double_limb = unsigned __int128;
+
+    struct Columns {
+        std::vector<double_limb> sum;
+        std::vector<limb> overflow;
+    };
+
+    Columns columns[2];
+    std::vector<limb> product;
+
+    static void add_to_column(Columns& c, size_t k, double_limb x) {
+        c.sum[k] += x;
+        c.overflow[k] += (c.sum[k] < x);
+    }
+
+    static BigInteger carry(const Columns& c) {
+        size_t n = c.sum.size();
+        std::vector<limb> r(n + 2);
+        double_limb add = 0;
+        for (size_t k = 0; k < n; k++) {
+            double_limb cur = c.sum[k] + add;
+            limb overflow = c.overflow[k] + (cur < add);
+            r[k] = static_cast<limb>(cur);
+            add = (cur >> BigInteger::limb_bits) | (static_cast<double_limb>(overflow) << BigInteger::limb_bits);
+        }
+        r[n] = static_cast<limb>(add);
+        r[n + 1] = static_cast<limb>(add >> BigInteger::limb_bits);
+        BigInteger result;
+        result.a = r;
+        BigInteger::delete_trailing_zeroes(result.a);
+        return result;
+    }
+
+public:
+    // adds x * y, negated when mul_sign is minus
+    void add(const BigInteger& x, const BigInteger& y, Sign mul_sign = Sign::plus) {
+        if (x.is_zero() || y.is_zero()) return;
+        Columns& c = columns[x.sign * y.sign * mul_sign == Sign::plus ? 0 : 1];
+        size_t n = x.size(), m = y.size();
+        if (c.sum.size() < n + m) {
+            c.sum.resize(n + m, 0);
+            c.overflow.resize(n + m, 0);
+        }
+        if (std::min(n, m) < BigInteger::karatsuba_threshold) {
+            for (size_t i = 0; i < n; i++) {
+                for (size_t j = 0; j < m; j++) {
+                    add_to_column(c, i + j, static_cast<double_limb>(x[i]) * y[j]);
+                }
+            }
+        } else {
+            product.resize(n + m);
+            BigInteger::multiply(product.data(), x.a.data(), n, y.a.data(), m);
+            for (size_t k = 0; k < n + m; k++) add_to_column(c, k, product[k]);
+        }
+    }
+
+    BigInteger value() const {
+        BigInteger result = carry(columns[0]);
+        result -= carry(columns[1]);
+        return result;
+    }
+};
+
 class Rational {
 private:
     BigInteger numerator;
@@ -430,12 +1827,45 @@ private:
         sign = sign * numerator.get_sign();
         numerator.set_sign(Sign::plus);
         if (is_zero()) sign = Sign::plus;
+        if (denominator.is_one()) return;
         BigInteger g = gcd(numerator, denominator);
         if (g.is_one()) return;
         numerator /= g;
         denominator /= g;
     }
 
+    // the top 64 bits of a nonzero magnitude as a double in [1, 2), within 2^-52 of the truncated value
+    static double leading_mantissa(const BigInteger& x) {
+        bool cut;
+        BigInteger::limb top = static_cast<BigInteger::limb>(x.leading_bits(cut) >> BigInteger::limb_bits);
+        return std::ldexp(static_cast<double>(top), -63);
+    }
+
+    // the sign of |x| - |y|: the cross products are only computed when neither their bit lengths
+    // nor their double estimates tell them apart
+    static int compare_magnitudes(const Rational& x, const Rational& y) {
+        if (x.is_zero() || y.is_zero()) return static_cast<int>(!x.is_zero()) - static_cast<int>(!y.is_zero());
+        const BigInteger::Limbs& xn = x.numerator.a;
+        const BigInteger::Limbs& yn = y.numerator.a;
+        if (x.denominator.is_one() && y.denominator.is_one()) {
+            return BigInteger::compare_limbs(xn.data(), xn.size(), yn.data(), yn.size());
+        }
+        // a product of a and b bits long has a + b - 1 or a + b bits
+        long long lhs_bits = x.numerator.bit_length() + y.denominator.bit_length();
+        long long rhs_bits = y.numerator.bit_length() + x.denominator.bit_length();
+        if (lhs_bits + 1 < rhs_bits) return -1;
+        if (rhs_bits + 1 < lhs_bits) return 1;
+        // each estimate is off by less than 2^-50 relative, so a gap of 2^-45 is decisive
+        double lhs = std::ldexp(leading_mantissa(x.numerator) * leading_mantissa(y.denominator),
+                                static_cast<int>(lhs_bits - rhs_bits));
+        double rhs = leading_mantissa(y.numerator) * leading_mantissa(x.denominator);
+        const double margin = std::ldexp(1.0, -45);
+        if (lhs < rhs * (1 - margin)) return -1;
+        if (lhs > rhs * (1 + margin)) return 1;
+        BigInteger p = x.numerator * y.denominator, q = y.numerator * x.denominator;
+        return BigInteger::compare_limbs(p.a.data(), p.size(), q.a.data(), q.size());
+    }
+
 public:
     Rational() : numerator(0), denominator(1), sign(Sign::plus) {}
 
@@ -451,6 +1881,18 @@ public:
 
     Rational(const Rational& x) : numerator(x.numerator), denominator(x.denominator), sign(x.sign) {}
 
+    friend class UnnormalizedRational;
+
+    friend void fma(Rational& acc, const Rational& x, const Rational& y);
+
+    friend bool operator<(const Rational& lhs, const Rational& rhs);
+
+    Rational(Rational&& x) noexcept
+            : numerator(std::move(x.numerator)), denominator(std::move(x.denominator)), sign(x.sign) {
+        x.denominator[0] = 1;
+        x.sign = Sign::plus;
+    }
+
     Rational& operator=(const Rational& x) {
         numerator = x.numerator;
         denominator = x.denominator;
@@ -458,6 +1900,16 @@ public:
         return *this;
     }
 
+    Rational& operator=(Rational&& x) noexcept {
+        if (this == &x) return *this;
+        numerator = std::move(x.numerator);
+        denominator = std::move(x.denominator);
+        sign = x.sign;
+        x.denominator[0] = 1;
+        x.sign = Sign::plus;
+        return *this;
+    }
+
     std::string toString() const {
         std::string res;
         if (sign == Sign::minus) res += '-';
@@ -478,6 +1930,7 @@ public:
     }
 
     Rational& operator+=(const Rational& x) {
+        if (this == &x) return *this += Rational(x);
         numerator.set_sign(sign);
         sign = Sign::plus;
         numerator *= x.denominator;
@@ -489,6 +1942,7 @@ public:
     }
 
     Rational& operator-=(const Rational& x) {
+        if (this == &x) return *this -= Rational(x);
         numerator.set_sign(sign);
         sign = Sign::plus;
         numerator *= x.denominator;
@@ -500,6 +1954,7 @@ public:
     }
 
     Rational& operator/=(const Rational& x) {
+        if (this == &x) return *this /= Rational(x);
         numerator *= x.denominator;
         denominator *= x.numerator;
         sign = sign * x.sign;
@@ -507,22 +1962,57 @@ public:
         return *this;
     }
 
-    Rational operator-() const {
+    Rational operator-() const& {
         Rational copy = *this;
-        copy.sign = copy.sign * Sign::minus;
-        copy.normalize();
+        if (!copy.is_zero()) copy.sign = copy.sign * Sign::minus;
         return copy;
     }
 
+    Rational operator-() && {
+        if (!is_zero()) sign = sign * Sign::minus;
+        return std::move(*this);
+    }
+
+    // an upper bound on the length of asDecimal(precision)
+    size_t decimal_length(size_t precision) const {
+        size_t n_bits = numerator.bit_length(), d_bits = denominator.bit_length();
+        size_t integer_digits = n_bits > d_bits ? (n_bits - d_bits + 1) * 30103 / 100000 + 2 : 1;
+        return 2 + integer_digits + precision;
+    }
+
+    // writes the value truncated to precision digits after the point into buffer, which has room
+    // for decimal_length(precision) characters, and returns the number of characters written
+    size_t asDecimal(char* buffer, size_t precision) const {
+        using limb = BigInteger::limb;
+        size_t start = 0;
+        if (sign == Sign::minus) buffer[start++] = '-';
+        std::vector<limb> scaled(numerator.a.begin(), numerator.a.end());
+        if (precision > 0) scaled = BigInteger::product(scaled, BigInteger::power_of_ten(precision));
+        BigInteger::trim(scaled);
+        if (!denominator.is_one()) {
+            std::vector<limb> q, r;
+            BigInteger::divmod_limbs(q, r, scaled.data(), scaled.size(), denominator.a.data(), denominator.size());
+            scaled = std::move(q);
+            BigInteger::trim(scaled);
+        }
+        char* digits = buffer + start;
+        size_t len = BigInteger::write_decimal(digits, scaled);
+        if (len > precision) {
+            std::memmove(digits + len - precision + 1, digits + len - precision, precision);
+            digits[len - precision] = '.';
+            return start + len + 1;
+        }
+        std::memmove(digits + 2 + precision - len, digits, len);
+        std::fill(digits + 2, digits + 2 + precision - len, '0');
+        digits[0] = '0';
+        digits[1] = '.';
+        return start + 2 + precision;
+    }
+
     std::string asDecimal(size_t precision = 0) const {
-        BigInteger result = numerator * std::string("1" + std::string(precision, '0'));
-        result /= denominator;
-        std::string decimal = result.toString();
-        int pos = std::max(static_cast<int>(0), static_cast<int>(decimal.size() - precision));
-        return (sign == Sign::minus ? std::string("-") : std::string(""))
-               + (pos == 0 ? std::string("0") : std::string(""))
-               + decimal.substr(0, pos) + "." + std::string(precision - (decimal.size() - pos), '0')
-               + decimal.substr(pos, precision);
+        std::string res(decimal_length(precision), '\0');
+        res.resize(asDecimal(&res[0], precision));
+        return res;
     }
 
     explicit operator bool() const {
@@ -530,7 +2020,8 @@ public:
     }
 
     explicit operator double() const {
-        return stod(asDecimal(30));
+        double result = BigInteger::quotient_to_double(numerator, denominator);
+        return sign == Sign::minus ? -result : result;
     }
 
     const Sign& get_sign() const {
@@ -546,65 +2037,286 @@ public:
     }
 };
 
-bool operator==(const Rational& lhs, const Rational& rhs) {
+inline bool operator==(const Rational& lhs, const Rational& rhs) {
     if (lhs.get_sign() != rhs.get_sign()) return false;
     return lhs.get_numerator() == rhs.get_numerator() && lhs.get_denominator() == rhs.get_denominator();
 }
 
-bool operator!=(const Rational& lhs, const Rational& rhs) {
+inline bool operator!=(const Rational& lhs, const Rational& rhs) {
     return !(lhs == rhs);
 }
 
-bool operator<(const Rational& lhs, const Rational& rhs) {
+inline bool operator<(const Rational& lhs, const Rational& rhs) {
     if (lhs.get_sign() != rhs.get_sign()) return lhs.get_sign() < rhs.get_sign();
-    return (lhs.get_sign() == Sign::minus) 
-            ^ (lhs.get_numerator() * rhs.get_denominator() < rhs.get_numerator() * lhs.get_denominator());
+    int cmp = Rational::compare_magnitudes(lhs, rhs);
+    return lhs.get_sign() == Sign::minus ? cmp > 0 : cmp < 0;
 }
 
-bool operator>(const Rational& lhs, const Rational& rhs) {
+inline bool operator>(const Rational& lhs, const Rational& rhs) {
     return rhs < lhs;
 }
 
-bool operator<=(const Rational& lhs, const Rational& rhs) {
+inline bool operator<=(const Rational& lhs, const Rational& rhs) {
     return !(rhs < lhs);
 }
 
-bool operator>=(const Rational& lhs, const Rational& rhs) {
+inline bool operator>=(const Rational& lhs, const Rational& rhs) {
     return !(lhs < rhs);
 }
 
-Rational operator*(const Rational& lhs, const Rational& rhs) {
+inline Rational operator*(const Rational& lhs, const Rational& rhs) {
     Rational copy = lhs;
     copy *= rhs;
     return copy;
 }
 
-Rational operator+(const Rational& lhs, const Rational& rhs) {
+inline Rational operator*(Rational&& lhs, const Rational& rhs) {
+    lhs *= rhs;
+    return std::move(lhs);
+}
+
+inline Rational operator*(const Rational& lhs, Rational&& rhs) {
+    rhs *= lhs;
+    return std::move(rhs);
+}
+
+inline Rational operator*(Rational&& lhs, Rational&& rhs) {
+    lhs *= rhs;
+    return std::move(lhs);
+}
+
+inline Rational operator+(const Rational& lhs, const Rational& rhs) {
     Rational copy = lhs;
     copy += rhs;
     return copy;
 }
 
-Rational operator-(const Rational& lhs, const Rational& rhs) {
+inline Rational operator+(Rational&& lhs, const Rational& rhs) {
+    lhs += rhs;
+    return std::move(lhs);
+}
+
+inline Rational operator+(const Rational& lhs, Rational&& rhs) {
+    rhs += lhs;
+    return std::move(rhs);
+}
+
+inline Rational operator+(Rational&& lhs, Rational&& rhs) {
+    lhs += rhs;
+    return std::move(lhs);
+}
+
+inline Rational operator-(const Rational& lhs, const Rational& rhs) {
     Rational copy = lhs;
     copy -= rhs;
     return copy;
 }
 
-Rational operator/(const Rational& lhs, const Rational& rhs) {
+inline Rational operator-(Rational&& lhs, const Rational& rhs) {
+    lhs -= rhs;
+    return std::move(lhs);
+}
+
+inline Rational operator/(const Rational& lhs, const Rational& rhs) {
     Rational copy = lhs;
     copy /= rhs;
     return copy;
 }
 
-std::ostream& operator<<(std::ostream& out, const Rational& a) {
+inline Rational operator/(Rational&& lhs, const Rational& rhs) {
+    lhs /= rhs;
+    return std::move(lhs);
+}
+
+inline std::ostream& operator<<(std::ostream& out, const Rational& a) {
     out << a.toString();
     return out;
 }
 
-std::istream& operator>>(std::istream& in, Rational& a) {
+inline std::istream& operator>>(std::istream& in, Rational& a) {
     std::string s;
     in >> s;
     a = Rational(s);
     return in;
 }
+
+// acc += x * y with a single normalization
+inline void fma(Rational& acc, const Rational& x, const Rational& y) {
+    if (&acc == &x || &acc == &y) {
+        acc += x * y;
+        return;
+    }
+    Sign product_sign = x.sign * y.sign;
+    acc.numerator.set_sign(acc.is_zero() ? Sign::plus : acc.sign * product_sign);
+    acc.sign = product_sign;
+    if (!x.denominator.is_one() || !y.denominator.is_one()) {
+        BigInteger q = x.denominator * y.denominator;
+        acc.numerator *= q;
+        fma(acc.numerator, x.numerator * y.numerator, acc.denominator);
+        acc.denominator *= q;
+    } else if (acc.denominator.is_one()) {
+        fma(acc.numerator, x.numerator, y.numerator);
+    } else {
+        fma(acc.numerator, x.numerator * y.numerator, acc.denominator);
+    }
+    acc.normalize();
+}
+
+// a fraction that skips the gcd after each operation: terms over a unit or an equal denominator keep it,
+// the others go over the lcm of the two denominators, and it is reduced only when its denominator has
+// doubled in size since the last reduction, or when it is read
+class UnnormalizedRational {
+private:
+    static constexpr size_t normalization_threshold = 8;
+
+    BigInteger numerator = 0;
+    BigInteger denominator = 1;
+    size_t reduce_at = normalization_threshold;
+
+    // adds |term| / d with sign s, for a nonzero term and a positive d
+    void add(BigInteger term, Sign s, const BigInteger& d) {
+        term.set_sign(s);
+        if (d.is_one()) {
+            if (denominator.is_one()) numerator += term;
+            else fma(numerator, term, denominator);
+            return;
+        }
+        if (denominator.is_one()) {
+            numerator *= d;
+            numerator += term;
+            denominator = d;
+        } else if (denominator == d) {
+            numerator += term;
+        } else {
+            // the gcd costs little next to the products it saves when the denominators share factors
+            BigInteger g = gcd(denominator, d);
+            if (g.is_one()) {
+                numerator *= d;
+                fma(numerator, term, denominator);
+                denominator *= d;
+            } else {
+                BigInteger d_part = d / g;
+                numerator *= d_part;
+                fma(numerator, term, denominator / g);
+                denominator *= d_part;
+            }
+        }
+        if (denominator.size() > reduce_at) normalize();
+    }
+
+public:
+    UnnormalizedRational() = default;
+
+    UnnormalizedRational(const Rational& x) : numerator(x.numerator), denominator(x.denominator) {
+        if (!x.is_zero()) numerator.set_sign(x.sign);
+    }
+
+    UnnormalizedRational& operator+=(const Rational& x) {
+        if (!x.is_zero()) add(x.numerator, x.sign, x.denominator);
+        return *this;
+    }
+
+    UnnormalizedRational& operator-=(const Rational& x) {
+        if (!x.is_zero()) add(x.numerator, x.sign * Sign::minus, x.denominator);
+        return *this;
+    }
+
+    // += x * y
+    void add_product(const Rational& x, const Rational& y) {
+        if (x.is_zero() || y.is_zero()) return;
+        add(x.numerator * y.numerator, x.sign * y.sign, x.denominator * y.denominator);
+    }
+
+    UnnormalizedRational& operator*=(const Rational& x) {
+        numerator *= x.numerator;
+        if (x.sign == Sign::minus) numerator = -numerator;
+        denominator *= x.denominator;
+        if (denominator.size() > reduce_at) normalize();
+        return *this;
+    }
+
+    UnnormalizedRational& operator/=(const Rational& x) {
+        numerator *= x.denominator;
+        if (x.sign == Sign::minus) numerator = -numerator;
+        denominator *= x.numerator;
+        if (denominator.size() > reduce_at) normalize();
+        return *this;
+    }
+
+    void normalize() {
+        Sign s = numerator.get_sign();
+        numerator.set_sign(Sign::plus);
+        if (!denominator.is_one()) {
+            BigInteger g = gcd(numerator, denominator);
+            if (!g.is_one()) {
+                numerator /= g;
+                denominator /= g;
+            }
+        }
+        if (!numerator.is_zero()) numerator.set_sign(s);
+        reduce_at = std::max(normalization_threshold, 2 * denominator.size());
+    }
+
+    Rational value() const {
+        Rational result;
+        result.numerator = numerator;
+        result.denominator = denominator;
+        result.normalize();
+        return result;
+    }
+};
+
+// products with unit denominators go to the integer accumulator, the others share one unnormalized
+// fraction, and the sum is normalized once when it is read. The inner products of matrix code are short
+// enough that the periodic reductions of UnnormalizedRational cost more than they save
+template <>
+class ProductSum<Rational> {
+private:
+    ProductSum<BigInteger> whole;
+    BigInteger numerator = 0;
+    BigInteger denominator = 1;
+
+public:
+    void add(const Rational& x, const Rational& y) {
+        Sign product_sign = x.get_sign() * y.get_sign();
+        if (x.get_denominator().is_one() && y.get_denominator().is_one()) {
+            whole.add(x.get_numerator(), y.get_numerator(), product_sign);
+            return;
+        }
+        BigInteger q = x.get_denominator() * y.get_denominator();
+        BigInteger p = x.get_numerator() * y.get_numerator();
+        if (product_sign == Sign::minus) p = -std::move(p);
+        numerator *= q;
+        fma(numerator, p, denominator);
+        denominator *= q;
+    }
+
+    Rational value() const {
+        BigInteger result = whole.value();
+        if (!denominator.is_one()) result *= denominator;
+        result += numerator;
+        Rational sum = result;
+        if (!denominator.is_one()) sum /= denominator;
+        return sum;
+    }
+};
+
+// the sum of products of [first1, last1) with the range starting at first2, accumulated in one ProductSum
+template <typename Iterator1, typename Iterator2>
+typename std::iterator_traits<Iterator1>::value_type dot(Iterator1 first1, Iterator1 last1, Iterator2 first2) {
+    ProductSum<typename std::iterator_traits<Iterator1>::value_type> sum;
+    for (; first1 != last1; ++first1, ++first2) sum.add(*first1, *first2);
+    return sum.value();
+}
+}
+
+// standalone users keep the unqualified names
+using BigNumber::Sign;
+using BigNumber::BigInteger;
+using BigNumber::Rational;
+using BigNumber::UnnormalizedRational;
+using BigNumber::ProductSum;
+using BigNumber::divmod;
+using BigNumber::gcd;
+using BigNumber::gcdex;
+using BigNumber::dot;
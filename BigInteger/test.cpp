@@ -0,0 +1,660 @@
+// g++ -std=c++17 -O2 -pthread test.cpp
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include "biginteger.h"
+
+std::mt19937_64 rng(2024);
+
+// a random number with the given count of decimal digits, of either sign when can_be_negative is set
+BigInteger random_integer(size_t digits, bool can_be_negative = false) {
+	std::string s(digits, '0');
+	s[0] = static_cast<char>('1' + rng() % 9);
+	for (size_t i = 1; i < digits; i++)
+		s[i] = static_cast<char>('0' + rng() % 10);
+	if (can_be_negative && rng() % 2)
+		s = "-" + s;
+	return BigInteger(s);
+}
+
+// schoolbook arithmetic on non-negative decimal strings in base 10^9, the basecase the results are checked against
+namespace Reference {
+	const uint64_t base = 1000000000;
+
+	std::vector<uint64_t> parse(const std::string& s) {
+		std::vector<uint64_t> x;
+		for (size_t end = s.size(); end > 0; end -= std::min<size_t>(end, 9))
+			x.push_back(std::stoull(s.substr(end - std::min<size_t>(end, 9), std::min<size_t>(end, 9))));
+		return x;
+	}
+
+	std::string print(std::vector<uint64_t> x) {
+		while (x.size() > 1 && x.back() == 0)
+			x.pop_back();
+		std::string s = std::to_string(x.back());
+		for (size_t i = x.size() - 1; i-- > 0;) {
+			std::string part = std::to_string(x[i]);
+			s += std::string(9 - part.size(), '0') + part;
+		}
+		return s;
+	}
+
+	bool less(const std::string& a, const std::string& b) {
+		return a.size() != b.size() ? a.size() < b.size() : a < b;
+	}
+
+	std::string add(const std::string& a, const std::string& b) {
+		std::vector<uint64_t> x = parse(a), y = parse(b);
+		x.resize(std::max(x.size(), y.size()) + 1, 0);
+		uint64_t carry = 0;
+		for (size_t i = 0; i < x.size(); i++) {
+			x[i] += (i < y.size() ? y[i] : 0) + carry;
+			carry = x[i] / base;
+			x[i] %= base;
+		}
+		return print(x);
+	}
+
+	// a - b for a >= b
+	std::string subtract(const std::string& a, const std::string& b) {
+		std::vector<uint64_t> x = parse(a), y = parse(b);
+		uint64_t borrow = 0;
+		for (size_t i = 0; i < x.size(); i++) {
+			uint64_t sub = (i < y.size() ? y[i] : 0) + borrow;
+			borrow = x[i] < sub;
+			x[i] = x[i] + borrow * base - sub;
+		}
+		return print(x);
+	}
+
+	std::string multiply(const std::string& a, const std::string& b) {
+		std::vector<uint64_t> x = parse(a), y = parse(b), r(x.size() + y.size() + 1, 0);
+		for (size_t i = 0; i < x.size(); i++) {
+			uint64_t carry = 0;
+			for (size_t j = 0; j < y.size(); j++) {
+				uint64_t cur = r[i + j] + x[i] * y[j] + carry;
+				r[i + j] = cur % base;
+				carry = cur / base;
+			}
+			for (size_t k = i + y.size(); carry; k++) {
+				r[k] += carry;
+				carry = r[k] / base;
+				r[k] %= base;
+			}
+		}
+		return print(r);
+	}
+
+	std::string power_of_two(size_t k) {
+		if (k == 0)
+			return "1";
+		std::string half = power_of_two(k / 2);
+		std::string s = multiply(half, half);
+		return k % 2 ? add(s, s) : s;
+	}
+}
+
+std::string random_digits(size_t digits) {
+	return random_integer(digits).toString();
+}
+
+// the expected decimal form of a signed sum, product or difference of magnitudes a and b
+std::string signed_sum(const std::string& a, bool a_negative, const std::string& b, bool b_negative) {
+	if (a_negative == b_negative) {
+		std::string sum = Reference::add(a, b);
+		return a_negative && sum != "0" ? "-" + sum : sum;
+	}
+	if (Reference::less(a, b))
+		return signed_sum(b, b_negative, a, a_negative);
+	std::string difference = Reference::subtract(a, b);
+	return a_negative && difference != "0" ? "-" + difference : difference;
+}
+
+std::string signed_product(const std::string& a, bool a_negative, const std::string& b, bool b_negative) {
+	std::string product = Reference::multiply(a, b);
+	return a_negative != b_negative && product != "0" ? "-" + product : product;
+}
+
+void check(bool condition, const std::string& message) {
+	if (!condition)
+		throw std::runtime_error(message);
+}
+
+void test_limb_arithmetic() {
+	// values on both sides of the 64-bit limb boundaries, where every carry and borrow crosses a limb
+	std::vector<std::string> values = {"0", "1", "2", "999999999", "1000000000"};
+	for (size_t k : {32, 63, 64, 65, 127, 128, 129, 192, 320}) {
+		std::string power = Reference::power_of_two(k);
+		values.push_back(Reference::subtract(power, "1"));
+		values.push_back(power);
+		values.push_back(Reference::add(power, "1"));
+	}
+	for (size_t digits : {15, 20, 39, 40, 60, 100, 300})
+		values.push_back(random_digits(digits));
+	for (const std::string& a : values) {
+		for (const std::string& b : values) {
+			for (int signs = 0; signs < 4; signs++) {
+				bool a_negative = signs & 1, b_negative = signs & 2;
+				BigInteger x(a_negative ? "-" + a : a), y(b_negative ? "-" + b : b);
+				check((x + y).toString() == signed_sum(a, a_negative, b, b_negative), "Sum differs from the reference.");
+				check((x - y).toString() == signed_sum(a, a_negative, b, !b_negative), "Difference differs from the reference.");
+				check((x * y).toString() == signed_product(a, a_negative, b, b_negative), "Product differs from the reference.");
+				BigInteger z = x;
+				z += y;
+				z -= y;
+				check(z == x, "Adding and subtracting in place does not restore the value.");
+			}
+		}
+		if (a == "0")
+			continue;
+		// single-limb divisors, where the quotient and remainder come from one pass over the limbs
+		for (const char* d : {"3", "1000000000", "18446744073709551615"}) {
+			BigInteger q = BigInteger(a) / BigInteger(d), r = BigInteger(a) % BigInteger(d);
+			check(Reference::add(Reference::multiply(q.toString(), d), r.toString()) == a && Reference::less(r.toString(), d),
+				"Division by a single limb differs from the reference.");
+		}
+	}
+	std::cerr << "Limb arithmetic passed!\n";
+}
+
+// a random positive number with exactly the given count of 64-bit limbs
+BigInteger random_limbs(size_t limbs) {
+	BigInteger x = random_integer(static_cast<size_t>(limbs * 64 * 0.30103));
+	check(x.size() == limbs, "Random number has the wrong count of limbs.");
+	return x;
+}
+
+void test_multiplication_tiers() {
+	// operand sizes on both sides of the Karatsuba, Toom-3 and transform thresholds, balanced and not
+	std::vector<std::pair<size_t, size_t>> sizes = {{1, 40}, {31, 31}, {32, 32}, {33, 70}, {31, 700}, {32, 500}, {249, 249},
+		{250, 250}, {250, 260}, {249, 1600}, {250, 1600}, {799, 799}, {800, 800}, {799, 2500}, {800, 2500}};
+	for (auto [n, m] : sizes) {
+		BigInteger x = random_limbs(n), y = random_limbs(m);
+		std::string a = x.toString(), b = y.toString();
+		std::string expected = Reference::multiply(a, b);
+		check((x * y).toString() == expected && (y * x).toString() == expected, "Product differs from the reference.");
+		check((x * x).toString() == Reference::multiply(a, a), "Square differs from the reference.");
+		BigInteger z = x;
+		z *= y;
+		check(z.toString() == expected, "In-place product differs from the reference.");
+	}
+	std::cerr << "Multiplication tiers passed!\n";
+}
+
+void test_fused_products() {
+	// products below 32 limbs go straight into the accumulator, longer ones through the multiplication
+	std::vector<size_t> sizes = {1, 2, 3, 20, 31, 32, 33, 100};
+	for (size_t n : sizes) {
+		for (size_t m : sizes) {
+			for (size_t k : {1, 2, 40, 200}) {
+				BigInteger x = random_limbs(n), y = random_limbs(m), acc = random_limbs(k);
+				for (int signs = 0; signs < 8; signs++) {
+					BigInteger a = signs & 1 ? -x : x, b = signs & 2 ? -y : y, c = signs & 4 ? -acc : acc;
+					BigInteger expected = c + a * b, result = c;
+					fma(result, a, b);
+					check(result == expected, "Fused multiply-add differs from the separate product and sum.");
+				}
+				BigInteger zero = 0;
+				fma(zero, x, -y);
+				check(zero == -(x * y), "Fused multiply-add into zero differs from the product.");
+				// the accumulator aliasing one or both factors
+				BigInteger c = -acc, t = acc, u = acc;
+				fma(c, c, y);
+				fma(t, t, t);
+				fma(u, x, u);
+				check(c == -acc - acc * y && t == acc + acc * acc && u == acc + x * acc,
+					"Fused multiply-add into an aliased factor differs from the separate product and sum.");
+			}
+		}
+	}
+	// long dot products mixing signs, sizes and the two paths, with sums cancelling to small values
+	for (size_t length : {1, 5, 50, 300}) {
+		std::vector<BigInteger> x, y;
+		for (size_t i = 0; i < length; i++) {
+			x.push_back(random_limbs(sizes[rng() % sizes.size()]) * (rng() % 2 ? 1 : -1));
+			y.push_back(random_limbs(sizes[rng() % sizes.size()]) * (rng() % 2 ? 1 : -1));
+		}
+		x.push_back(x[0]);
+		y.push_back(-y[0]);
+		BigInteger expected = 0;
+		for (size_t i = 0; i < x.size(); i++)
+			expected += x[i] * y[i];
+		check(dot(x.begin(), x.end(), y.begin()) == expected, "Dot product differs from the sum of products.");
+		ProductSum<BigInteger> sum;
+		for (size_t i = 0; i < x.size(); i++)
+			sum.add(x[i], y[i], Sign::minus);
+		check(sum.value() == -expected, "Subtracted products differ from the negated sum.");
+		std::vector<Rational> p, q;
+		for (size_t i = 0; i < x.size(); i++) {
+			p.push_back(i % 3 ? Rational(x[i]) : Rational(x[i]) / Rational(random_limbs(2)));
+			q.push_back(i % 4 ? Rational(y[i]) : Rational(y[i]) / Rational(random_limbs(1)));
+		}
+		Rational rational_expected = 0, acc = 0;
+		for (size_t i = 0; i < p.size(); i++) {
+			rational_expected += p[i] * q[i];
+			fma(acc, p[i], q[i]);
+		}
+		check(dot(p.begin(), p.end(), q.begin()) == rational_expected && acc == rational_expected,
+			"Rational dot product differs from the sum of products.");
+		Rational z = p[0], w = q[0], v = p[0];
+		fma(z, z, q[0]);
+		fma(w, p[0], w);
+		fma(v, v, v);
+		check(z == p[0] + p[0] * q[0] && w == q[0] + p[0] * q[0] && v == p[0] + p[0] * p[0],
+			"Rational fused multiply-add into an aliased factor differs from the separate product and sum.");
+	}
+	std::cerr << "Fused products passed!\n";
+}
+
+// the sign of x - y from the cross products, the way every comparison used to be made
+int cross_compare(const Rational& x, const Rational& y) {
+	BigInteger lhs = x.get_numerator() * y.get_denominator(), rhs = y.get_numerator() * x.get_denominator();
+	if (x.get_sign() == Sign::minus)
+		lhs = -lhs;
+	if (y.get_sign() == Sign::minus)
+		rhs = -rhs;
+	return lhs < rhs ? -1 : rhs < lhs ? 1 : 0;
+}
+
+void test_rational_comparison() {
+	std::vector<std::pair<Rational, Rational>> pairs;
+	for (int i = 0; i < 200; i++) {
+		size_t n = rng() % 50 + 1, m = rng() % 50 + 1;
+		Rational x = Rational(random_limbs(n)) / Rational(random_limbs(m));
+		Rational y = Rational(random_limbs(n)) / Rational(random_limbs(m));
+		Rational tiny = Rational(1) / Rational(random_limbs(rng() % 200 + 1));
+		// decided by the bit lengths, by the double estimates, and only by the exact products
+		pairs.push_back({x, y});
+		pairs.push_back({x, x * Rational(3) / Rational(2)});
+		pairs.push_back({x, x + tiny});
+		pairs.push_back({x, x - tiny});
+		pairs.push_back({x, x});
+		pairs.push_back({x, Rational(random_limbs(n))});
+		pairs.push_back({Rational(random_limbs(n)), Rational(random_limbs(n))});
+		pairs.push_back({x, 0});
+	}
+	for (auto [x, y] : pairs) {
+		for (int signs = 0; signs < 4; signs++) {
+			Rational a = signs & 1 ? -x : x, b = signs & 2 ? -y : y;
+			int expected = cross_compare(a, b);
+			check((a < b) == (expected < 0) && (a > b) == (expected > 0) && (a <= b) == (expected <= 0)
+				&& (a >= b) == (expected >= 0) && (a == b) == (expected == 0), "Comparison differs from the cross products.");
+		}
+	}
+	std::cerr << "Rational comparison passed!\n";
+}
+
+void test_unnormalized_rational() {
+	// the denominator is reduced once it has grown past 8 limbs, and from then on whenever it doubles:
+	// runs of terms over unit, repeated and fresh denominators cross that many times
+	std::vector<Rational> shared = {Rational(1) / Rational(random_limbs(2)), Rational(1) / Rational(random_limbs(3))};
+	for (int run = 0; run < 20; run++) {
+		Rational expected = Rational(random_limbs(2)) / Rational(random_limbs(1));
+		UnnormalizedRational sum = expected;
+		for (int i = 0; i < 100; i++) {
+			Rational x = Rational(random_limbs(rng() % 3 + 1)), y = Rational(random_limbs(rng() % 2 + 1));
+			switch (rng() % 7) {
+				case 0: x /= y; break;
+				case 1: x *= shared[rng() % 2]; break;
+				case 2: x = -x / Rational(static_cast<int>(rng() % 1000 + 1)); break;
+				default: break;
+			}
+			switch (rng() % 5) {
+				case 0:
+					sum -= x;
+					expected -= x;
+					break;
+				case 1:
+					sum.add_product(x, y);
+					expected += x * y;
+					break;
+				case 2:
+					if (rng() % 4 == 0) {
+						sum *= x / y;
+						expected *= x / y;
+					} else {
+						sum += x;
+						expected += x;
+					}
+					break;
+				default:
+					sum += x;
+					expected += x;
+					break;
+			}
+			if (i % 10 == 0)
+				check(sum.value() == expected, "Delayed-normalization sum differs from the normalized one.");
+		}
+		check(sum.value() == expected, "Delayed-normalization sum differs from the normalized one.");
+		sum -= expected;
+		sum /= Rational(3);
+		check(sum.value() == 0, "Delayed-normalization sum does not cancel to zero.");
+	}
+	UnnormalizedRational harmonic;
+	Rational expected = 0;
+	for (int i = 1; i <= 300; i++) {
+		harmonic += Rational(1) / Rational(i);
+		expected += Rational(1) / Rational(i);
+	}
+	check(harmonic.value() == expected, "Delayed-normalization harmonic sum differs from the normalized one.");
+	std::cerr << "Delayed normalization passed!\n";
+}
+
+// every mix of lvalue and rvalue operands has to give the result of the copying operators
+template <typename T>
+void check_rvalue_operators(const T& x, const T& y) {
+	T sum = x + y, difference = x - y, product = x * y, quotient = x / y;
+	check(T(x) + y == sum && x + T(y) == sum && T(x) + T(y) == sum, "Sum of temporaries differs.");
+	check(T(x) - y == difference && x - T(y) == difference && T(x) - T(y) == difference, "Difference of temporaries differs.");
+	check(T(x) * y == product && x * T(y) == product && T(x) * T(y) == product, "Product of temporaries differs.");
+	check(T(x) / y == quotient && -T(x) == -x, "Quotient or negation of a temporary differs.");
+	// in place, including with the operand aliasing the result
+	T a = x, b = x, c = x, d = x;
+	a += a;
+	b -= b;
+	c *= c;
+	d /= d;
+	check(a == x + x && b == 0 && c == x * x && d == 1, "Operator applied to itself differs.");
+	T moved = x, target = y;
+	target = std::move(moved);
+	check(target == x && moved == 0 && moved + y == y, "Moved-from value is not a usable zero.");
+	T constructed(std::move(target));
+	check(constructed == x && target == 0, "Move-constructed value differs from the source.");
+}
+
+void test_move_semantics() {
+	for (size_t n : {1, 2, 3, 40, 900}) {
+		for (size_t m : {1, 2, 40, 900}) {
+			BigInteger x = random_limbs(n), y = -random_limbs(m);
+			check_rvalue_operators(x, y);
+			check(BigInteger(x) % y == x % y, "Remainder of a temporary differs.");
+			std::string a = x.toString(), b = y.toString().substr(1);
+			check((BigInteger(x) + BigInteger(y)).toString() == signed_sum(a, false, b, true) &&
+				(BigInteger(x) * BigInteger(y)).toString() == signed_product(a, false, b, true), "Temporaries differ from the reference.");
+			Rational p = Rational(x) / Rational(random_limbs(m)), q = Rational(y) / Rational(random_limbs(n));
+			check_rvalue_operators(p, q);
+		}
+	}
+	std::cerr << "Move semantics passed!\n";
+}
+
+void test_inline_storage() {
+	// up to two limbs live inside the object: grow a value through that boundary and back, limb by limb
+	std::string factor = Reference::power_of_two(40), expected = "12345";
+	BigInteger x = 12345;
+	std::vector<BigInteger> steps;
+	for (int i = 0; i < 8; i++) {
+		steps.push_back(x);
+		x *= BigInteger(factor);
+		expected = Reference::multiply(expected, factor);
+		check(x.toString() == expected, "Growing product differs from the reference.");
+	}
+	for (int i = 7; i >= 0; i--) {
+		x /= BigInteger(factor);
+		check(x == steps[i], "Shrinking quotient differs from the value on the way up.");
+	}
+	// copies and moves between inline and allocated values in every direction
+	for (size_t i = 0; i < steps.size(); i++) {
+		for (size_t j = 0; j < steps.size(); j++) {
+			BigInteger a = steps[i], b = steps[j];
+			a = b;
+			check(a == steps[j] && b == steps[j], "Copy assignment differs from the source.");
+			a = steps[i];
+			a = std::move(b);
+			check(a == steps[j] && b == 0, "Move assignment differs from the source.");
+			b = a + steps[i];
+			check(b - steps[i] == steps[j], "Moved-from value is not reusable.");
+			std::swap(a, b);
+			check(b == steps[j] && a - steps[i] == steps[j], "Swapped values differ.");
+		}
+	}
+	// a value that shrank back to one limb while allocated still compares and copies like an inline one
+	BigInteger y = steps.back();
+	y -= steps.back() - 7;
+	BigInteger z = y;
+	check(y == 7 && z == 7 && y.size() == 1 && (y * y).toString() == "49", "Shrunken value differs from the reference.");
+	std::cerr << "Inline storage passed!\n";
+}
+
+void test_gcd() {
+	// the half-gcd takes over at 100 limbs, below that and for one or two limbs the binary and Lehmer steps do
+	std::vector<std::tuple<size_t, size_t, size_t>> sizes = {{1, 1, 1}, {1, 1, 2}, {1, 2, 2}, {2, 10, 12}, {20, 40, 45},
+		{50, 49, 49}, {1, 99, 99}, {1, 100, 100}, {60, 150, 300}, {200, 400, 400}};
+	for (auto [k, n, m] : sizes) {
+		BigInteger g = random_limbs(k), x = g * random_limbs(n), y = g * random_limbs(m);
+		// the basecase: Euclid's algorithm with one division per step
+		BigInteger a = x, b = y;
+		while (b != 0) {
+			a %= b;
+			std::swap(a, b);
+		}
+		for (int signs = 0; signs < 4; signs++) {
+			BigInteger p = signs & 1 ? -x : x, q = signs & 2 ? -y : y, u, v;
+			check(gcd(p, q) == a && gcd(q, p) == a, "Greatest common divisor differs from Euclid's.");
+			check(gcdex(p, q, u, v) == a && p * u + q * v == a, "Extended greatest common divisor differs from Euclid's.");
+		}
+	}
+	BigInteger x = random_limbs(150), u, v;
+	check(gcd(x, 0) == x && gcd(0, -x) == x && gcdex(-x, 0, u, v) == x && -x * u == x, "Greatest common divisor with zero is wrong.");
+	std::cerr << "Greatest common divisor passed!\n";
+}
+
+void test_radix_conversion() {
+	// 30 limbs is about 580 digits, the divide-and-conquer conversion takes everything from there up
+	for (size_t digits : {1, 9, 19, 20, 39, 300, 570, 580, 600, 1200, 5000, 20000}) {
+		std::string s = random_digits(digits);
+		// the basecase: nine digits at a time, with single-limb operands only
+		BigInteger expected = 0;
+		for (size_t i = 0; i < s.size(); i += 9) {
+			size_t len = std::min<size_t>(9, s.size() - i);
+			expected = expected * BigInteger(std::string("1") + std::string(len, '0')) + BigInteger(s.substr(i, len));
+		}
+		check(BigInteger(s) == expected && BigInteger("-" + s) == -expected, "Parsed number differs from the basecase.");
+		check(expected.toString() == s && (-expected).toString() == "-" + s, "Printed number differs from the input.");
+		check(BigInteger("000" + s) == expected, "Leading zeroes change the parsed number.");
+	}
+	check(BigInteger("-0").toString() == "0" && BigInteger("0").toString() == "0", "Zero is printed wrong.");
+	// longer than anything converted before, so the threads race to extend the table of powers
+	std::vector<std::string> inputs(4);
+	for (std::string& s : inputs) {
+		s.assign(400000, '1');
+		for (size_t i = 1; i < s.size(); i++)
+			s[i] = static_cast<char>('0' + rng() % 10);
+	}
+	std::vector<std::string> outputs(inputs.size());
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < inputs.size(); i++)
+		threads.emplace_back([&, i] { outputs[i] = BigInteger(inputs[i]).toString(); });
+	for (std::thread& t : threads)
+		t.join();
+	check(outputs == inputs, "Concurrent conversions differ from the input.");
+	std::cerr << "Radix conversion passed!\n";
+}
+
+void test_division() {
+	// divisors on both sides of the Burnikel-Ziegler and Newton thresholds, with short and long quotients
+	std::vector<std::pair<size_t, size_t>> sizes = {{2, 80}, {39, 80}, {40, 80}, {41, 200}, {100, 101}, {100, 1000},
+		{1999, 4000}, {2000, 2001}, {2000, 4000}, {2100, 6000}};
+	for (auto [m, n] : sizes) {
+		BigInteger x = random_limbs(n), y = random_limbs(m);
+		std::string a = x.toString(), b = y.toString();
+		for (int signs = 0; signs < 4; signs++) {
+			BigInteger dividend = signs & 1 ? -x : x, divisor = signs & 2 ? -y : y;
+			BigInteger q = dividend / divisor, r = dividend % divisor;
+			std::string q_abs = (q < 0 ? -q : q).toString(), r_abs = (r < 0 ? -r : r).toString();
+			check(Reference::add(Reference::multiply(q_abs, b), r_abs) == a && Reference::less(r_abs, b),
+				"Quotient and remainder differ from the reference.");
+			check((q < 0) == (q != 0 && (signs == 1 || signs == 2)) && (r < 0) == (r != 0 && (signs & 1)),
+				"Quotient and remainder have the wrong signs.");
+		}
+		// exact multiples and one less, where a quotient estimate one too large has to be corrected
+		std::string c = random_limbs(n - m + 1).toString();
+		BigInteger product(Reference::multiply(b, c));
+		check(product / y == BigInteger(c) && product % y == 0, "Exact division differs from the reference.");
+		product -= 1;
+		check(product / y == BigInteger(c) - 1 && product % y == y - 1, "Division of a multiple less one differs from the reference.");
+	}
+	std::cerr << "Division passed!\n";
+}
+
+void test_transform_multiplication() {
+	// 800 limbs is about 15,400 digits, the transform takes everything from there up
+	for (auto [n, m] : std::vector<std::pair<size_t, size_t>>{{15000, 15000}, {16000, 16000}, {16000, 21000}, {30000, 30000}}) {
+		std::string a = random_digits(n), b = random_digits(m);
+		BigInteger x(a), y("-" + b);
+		check((x * y).toString() == "-" + Reference::multiply(a, b), "Transform product differs from the reference.");
+		check((x * x).toString() == Reference::multiply(a, a), "Transform square differs from the reference.");
+	}
+	// all limbs 2^64 - 1 give the largest convolution terms the three primes have to recover exactly
+	std::string ones = Reference::subtract(Reference::power_of_two(64 * 1500), "1");
+	BigInteger x(ones);
+	check((x * x).toString() == Reference::multiply(ones, ones), "Transform square of all-ones limbs differs from the reference.");
+	std::cerr << "Transform multiplication passed!\n";
+}
+
+// the exact value of a finite double
+Rational exact(double d) {
+	int exponent;
+	double mantissa = std::frexp(std::fabs(d), &exponent);
+	Rational result = BigInteger(std::to_string(static_cast<unsigned long long>(std::ldexp(mantissa, 53))));
+	exponent -= 53;
+	BigInteger power(Reference::power_of_two(static_cast<size_t>(std::abs(exponent))));
+	result = exponent >= 0 ? result * Rational(power) : result / Rational(power);
+	return d < 0 ? -result : result;
+}
+
+// whether the lowest bit of the significand of d is zero
+bool even_significand(double d) {
+	uint64_t bits;
+	std::memcpy(&bits, &d, sizeof(bits));
+	return bits % 2 == 0;
+}
+
+// r rounded to the nearest double, ties to even, checked against the neighbours of d
+void check_rounding(const Rational& r) {
+	double d = static_cast<double>(r);
+	Rational magnitude = r < 0 ? -r : r;
+	if (std::isinf(d)) {
+		// halfway between the largest double and 2^1024 already rounds up, the largest double being odd
+		Rational limit = exact(std::numeric_limits<double>::max()) + exact(std::ldexp(1.0, 970));
+		check((d > 0) == (r > 0) && magnitude >= limit, "Rational below the overflow threshold converts to infinity.");
+		return;
+	}
+	Rational error = r - exact(d);
+	if (error < 0)
+		error = -error;
+	for (double neighbour : {std::nextafter(d, -HUGE_VAL), std::nextafter(d, HUGE_VAL)}) {
+		if (std::isinf(neighbour))
+			continue;
+		Rational other = r - exact(neighbour);
+		if (other < 0)
+			other = -other;
+		check(error < other || (error == other && even_significand(d)), "Rational is not rounded to the nearest double.");
+	}
+}
+
+// the original asDecimal: the numerator scaled by a power of ten and divided, the point put into the digits
+std::string baseline_decimal(const Rational& x, size_t precision) {
+	BigInteger result = x.get_numerator() * BigInteger("1" + std::string(precision, '0'));
+	result /= x.get_denominator();
+	std::string decimal = result.toString();
+	int pos = std::max(static_cast<int>(0), static_cast<int>(decimal.size() - precision));
+	return (x.get_sign() == Sign::minus ? std::string("-") : std::string(""))
+		+ (pos == 0 ? std::string("0") : std::string(""))
+		+ decimal.substr(0, pos) + "." + std::string(precision - (decimal.size() - pos), '0')
+		+ decimal.substr(pos, precision);
+}
+
+void test_rational_conversion() {
+	std::vector<Rational> values = {0, 1, -1, Rational(1) / Rational(3), Rational(-2) / Rational(3)};
+	for (int i = 0; i < 300; i++) {
+		Rational r = Rational(random_limbs(rng() % 40 + 1)) / Rational(random_limbs(rng() % 40 + 1));
+		values.push_back(rng() % 2 ? -r : r);
+	}
+	// exact halfway cases and values just beside them, where the top limbs alone cannot decide
+	for (int i = 0; i < 100; i++) {
+		double d = std::ldexp(static_cast<double>(rng() >> 11) + 1, static_cast<int>(rng() % 200) - 100 - 53);
+		Rational half = (exact(d) + exact(std::nextafter(d, HUGE_VAL))) / Rational(2);
+		Rational tiny = Rational(1) / Rational(random_limbs(30));
+		for (const Rational& r : {half, half + tiny, half - tiny, exact(d), -half})
+			values.push_back(r);
+	}
+	// subnormals, the smallest values that round up from zero, and the top of the range
+	Rational min_subnormal = exact(std::numeric_limits<double>::denorm_min()), max = exact(std::numeric_limits<double>::max());
+	Rational half_ulp_max = exact(std::ldexp(1.0, 970));
+	for (const Rational& r : {min_subnormal, min_subnormal * Rational(3) / Rational(2), min_subnormal / Rational(2),
+		min_subnormal / Rational(2) + min_subnormal / Rational(1000), min_subnormal / Rational(3), exact(std::ldexp(1.0, -1022)) / Rational(7),
+		max, max + half_ulp_max - Rational(1), max + half_ulp_max, max * Rational(2)})
+		values.push_back(r);
+	for (const Rational& r : values) {
+		check_rounding(r);
+		for (size_t precision : {0, 1, 5, 30, 200})
+			check(r.asDecimal(precision) == baseline_decimal(r, precision), "Decimal expansion differs from the original one.");
+	}
+	std::cerr << "Rational conversion passed!\n";
+}
+
+void test_parallel_multiplication() {
+	// about 17,700 limbs each, so the transform is 2^16 long and takes the parallel path
+	BigInteger x = random_integer(340000, true);
+	BigInteger y = random_integer(340000, true);
+	Parallel::set_thread_count(1);
+	BigInteger serial = x * y;
+	BigInteger serial_square = x * x;
+	Parallel::set_thread_count(4);
+	if (x * y != serial || x * x != serial_square)
+		throw std::runtime_error("Parallel multiplication differs from the serial one.");
+	// a throwing task reaches the caller once every task has run, and leaves the pool usable
+	std::atomic<size_t> calls{0};
+	bool thrown = false;
+	try {
+		Parallel::pool().run(16, [&](size_t i) {
+			++calls;
+			if (i % 5 == 1)
+				throw std::length_error("task failed");
+		});
+	} catch (const std::length_error&) {
+		thrown = true;
+	}
+	check(thrown && calls == 16, "Exception of a pool task is not passed to the caller after the job.");
+	check(x * y == serial, "Parallel multiplication differs from the serial one after a failed job.");
+	// every range of parallel_for has at least grain indices, and together they cover the loop
+	for (size_t count : {1024, 1025, 2047, 2048, 5000, 100000}) {
+		std::mutex ranges_mutex;
+		std::vector<std::pair<size_t, size_t>> ranges;
+		Parallel::parallel_for(3, 3 + count, 1024, [&](size_t first, size_t last) {
+			std::lock_guard<std::mutex> lock(ranges_mutex);
+			ranges.emplace_back(first, last);
+		});
+		std::sort(ranges.begin(), ranges.end());
+		size_t next = 3;
+		for (auto [first, last] : ranges) {
+			check(first == next && last - first >= 1024, "Ranges of parallel_for are short or do not cover the loop.");
+			next = last;
+		}
+		check(next == 3 + count, "Ranges of parallel_for do not cover the loop.");
+	}
+	Parallel::set_thread_count(std::thread::hardware_concurrency());
+	std::cerr << "Parallel multiplication passed!\n";
+}
+
+int main() {
+	test_limb_arithmetic();
+	test_transform_multiplication();
+	test_multiplication_tiers();
+	test_division();
+	test_radix_conversion();
+	test_gcd();
+	test_inline_storage();
+	test_move_semantics();
+	test_fused_products();
+	test_rational_conversion();
+	test_unnormalized_rational();
+	test_rational_comparison();
+	test_parallel_multiplication();
+}
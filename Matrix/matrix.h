@@ -1,643 +1,270 @@
+#pragma once
+
 #include <iostream>
 #include <vector>
-#include <complex>
-
-namespace BigNumber {
-const double PI = acos(-1.0);
-
-enum class Sign {
-    plus = 1,
-    minus = -1
-};
-
-Sign operator*(Sign x, Sign y) {
-    if (x == y) return Sign::plus;
-    else return Sign::minus;
+#include <string>
+#include <cmath>
+#include <array>
+#include <new>
+#include <cstdint>
+#include <algorithm>
+#include <iterator>
+#include <type_traits>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#include "../Parallel/parallel.h"
+#include "../BigInteger/biginteger.h"
+
+namespace Modular {
+using wide = unsigned __int128;
+
+// the high 128 bits of the 256-bit product x * y
+constexpr wide multiply_high(wide x, wide y) {
+    wide x_low = static_cast<uint64_t>(x), x_high = x >> 64;
+    wide y_low = static_cast<uint64_t>(y), y_high = y >> 64;
+    wide middle = (x_low * y_low >> 64) + static_cast<uint64_t>(x_high * y_low) + static_cast<uint64_t>(x_low * y_high);
+    return x_high * y_high + (x_high * y_low >> 64) + (x_low * y_high >> 64) + (middle >> 64);
 }
 
-class BigInteger {
-private:
-    std::vector<long long> a;
-    Sign sign = Sign::plus;
-    static const long long base = 1000000;
-    static const size_t base_len = 6;
-
-private:
-    static std::string number_to_string(long long x) {
-        std::string result = std::to_string(x);
-        return std::string(base_len - result.size(), '0') + result;
-    }
-    
-    static void reverse(std::string& s) {
-        if (s.size() == 0) return;
-        for (size_t curl = 0, curr = s.size() - 1; curl < curr; curl++, curr--) {
-            std::swap(s[curl], s[curr]);
-        }
-    }
-
-    static void delete_trailing_zeroes(std::string& s) {
-        reverse(s);
-        while (s.size() > 1 && s.back() == '0') s.pop_back();
-        reverse(s);
-    }
-
-    static void delete_trailing_zeroes(std::vector<long long>& x) {
-        while (x.size() > 1 && x.back() == 0) x.pop_back();
-    }
+// arithmetic modulo any mod >= 1 on the residues themselves by Barrett reduction: a product x < 2^128 is
+// reduced by estimating x / mod as the high half of x * floor((2^128 - 1) / mod)
+class Barrett {
+public:
+    uint64_t mod;
+    wide reciprocal;
 
-    static Sign sgn(long long x) {
-        return static_cast<Sign>((0 <= x) - (x < 0));
-    }
+    constexpr explicit Barrett(uint64_t mod) : mod(mod), reciprocal(~wide(0) / mod) {}
 
-    static void FFT(std::vector<std::complex<double>>& a, bool invert) {
-        long long n = a.size();
-        for (int i = 1, j = 0; i < n - 1; i++) {
-            for (int s = n; j ^= s >>= 1, ~j & s;);
-            if (i < j) swap(a[i], a[j]);
-        }
-        for (int len = 2; len <= n; len <<= 1) {
-            double angle = 2 * PI / len * (invert ? -1 : 1);
-            std::complex<double> wlen(cos(angle), sin(angle)), w, u, v;
-            for (int i = 0; i < n; i += len) {
-                w = 1;
-                for (int j = 0; j < len / 2; j++) {
-                    u = a[i + j], v = a[i + j + len / 2] * w;
-                    a[i + j] = u + v;
-                    a[i + j + len / 2] = u - v;
-                    w *= wlen;
-                }
-            }
-        }
-        if (invert) {
-            for (int i = 0; i < n; ++i) {
-                a[i] /= n;
-            }
-        }
+    // x % mod for any x, the estimated quotient being at most two short
+    constexpr uint64_t reduce(wide x) const {
+        wide result = x - multiply_high(x, reciprocal) * mod;
+        while (result >= mod) result -= mod;
+        return static_cast<uint64_t>(result);
     }
 
-    void abs_subtract_small_from_big(const BigInteger& small, bool fl = false) {
-        size_t len_small = small.size();
-        size_t len_big = a.size();
-        if (fl) std::swap(len_small, len_big);
-        a.resize(len_big, 0);
-        long long sign_fl = (fl ? -1 : 1);
-        for (size_t i = 0; i < small.size(); i++) {
-            a[i] -= small[i];
-            a[i] *= sign_fl;
-        }
-        long long subtract = 0;
-        for (size_t i = 0; i < len_big; i++) {
-            a[i] -= subtract;
-            subtract = 0;
-            if (a[i] < 0) {
-                a[i] += base;
-                subtract = 1;
-            }
-        }
-        delete_trailing_zeroes(a);
+    constexpr uint64_t to(uint64_t x) const {
+        return x % mod;
     }
 
-    static bool less_abs(const BigInteger& lhs, const BigInteger& rhs) {
-        if (lhs.size() != rhs.size()) return (lhs.size() < rhs.size());
-        for (int i = lhs.size() - 1; i >= 0; i--) {
-            if (lhs[i] != rhs[i]) return (lhs[i] < rhs[i]);
-        }
-        return false;
+    constexpr uint64_t multiply(uint64_t x, uint64_t y) const {
+        return reduce(static_cast<wide>(x) * y);
     }
 
-    static void div10(BigInteger& x) {
-        long long add = 0;
-        for (int i = x.size() - 1; i >= 0; i--) {
-            long long cur = x[i] + add * base;
-            x[i] = cur / 10;
-            add = cur % 10;
-        }
-        delete_trailing_zeroes(x.a);
+    constexpr uint64_t add(uint64_t x, uint64_t y) const {
+        return x >= mod - y ? x - (mod - y) : x + y;
     }
 
-    void add_with_sign(const BigInteger& x, Sign mul_sign) {
-        Sign lhs_sign = sign;
-        Sign rhs_sign = x.sign * mul_sign;
-        if (lhs_sign == rhs_sign) {
-            long long add = 0;
-            size_t len = std::max(a.size(), x.size());
-            a.resize(len, 0);
-            for (size_t i = 0; i < len; i++) {
-                a[i] = a[i] + (i < x.size() ? x[i] : 0) + add;
-                add = a[i] / base;
-                a[i] %= base;
-            }
-            a.push_back(add);
-            sign = lhs_sign;
-        } else {
-            if (less_abs(*this, x)) {
-                abs_subtract_small_from_big(x, true);
-                sign = rhs_sign;
-            } else {
-                abs_subtract_small_from_big(x, false);
-                sign = lhs_sign;
-            }
-            if (is_zero()) sign = Sign::plus;
-        }
-        delete_trailing_zeroes(a);
+    constexpr uint64_t subtract(uint64_t x, uint64_t y) const {
+        return x >= y ? x - y : x + (mod - y);
     }
 
-public:
-    BigInteger() : a({0}), sign(Sign::plus) {}
-
-    BigInteger(const std::string& s) {
-        a.clear();
-        sign = Sign::plus;
-        int cur = 0;
-        if (s[cur] == '-') {
-            sign = Sign::minus;
-            cur++;
-        }
-        for (int i = s.size() - 1; i >= cur; i -= base_len) {
-            long long number = 0;
-            for (int j = std::max(cur, static_cast<int>(i - base_len + 1)); j <= i; j++) {
-                number *= 10;
-                number += s[j] - '0';
-            }
-            a.push_back(number);
+    constexpr uint64_t power(uint64_t x, uint64_t m) const {
+        uint64_t result = to(1);
+        for (; m; m >>= 1) {
+            if (m & 1) result = multiply(result, x);
+            x = multiply(x, x);
         }
-        delete_trailing_zeroes(a);
-    }
-
-    BigInteger(int x) : sign(sgn(x)) {
-        x = abs(x);
-        do {
-            a.push_back(x % base);
-            x /= base;
-        } while (x > 0);
-    }
-
-    BigInteger(const BigInteger& x) : a(x.a), sign(x.sign) {}
-
-    BigInteger& operator=(const BigInteger& x) {
-        a = x.a;
-        sign = x.sign;
-        return *this;
-    }
-
-    std::string toString() const {
-        std::string res;
-        for (size_t i = a.size() - 1; ; i--) {
-            res += number_to_string(a[i]);
-            if (i == 0) break;
-        }
-        delete_trailing_zeroes(res);
-        if (sign == Sign::minus) res = "-" + res;
-        return res;
-    }
-
-    BigInteger& operator*=(const BigInteger& x) {
-        std::vector<std::complex<double>> fa(a.begin(), a.end());
-        std::vector<std::complex<double>> fb(x.a.begin(), x.a.end());
-        size_t n = 1;
-        while (n < std::max(a.size(), x.a.size())) n <<= 1;
-        n <<= 1;
-        fa.resize(n);
-        fb.resize(n);
-        FFT(fa, false);
-        FFT(fb, false);
-        for (size_t i = 0; i < n; ++i) {
-            fa[i] *= fb[i];
-        }
-        FFT(fa, true);
-        std::vector<long long> res(n);
-        for (size_t i = 0; i < n; ++i) {
-            res[i] = static_cast<long long>(fa[i].real() + 0.5);
-        }
-        long long add = 0;
-        for (size_t i = 0; i < n; i++) {
-            res[i] += add;
-            add = res[i] / base;
-            res[i] %= base;
-        }
-        delete_trailing_zeroes(res);
-        sign = sign * x.sign;
-        a = res;
-        if (is_zero()) sign = Sign::plus;
-        return *this;
-    }
-    
-    BigInteger& operator+=(const BigInteger& x) {
-        add_with_sign(x, Sign::plus);
-        return *this;
+        return result;
     }
+};
 
-    BigInteger& operator/=(const BigInteger& x) {
-        if (x.size() > a.size()) {
-            a = {0};
-            sign = Sign::plus;
-            return *this;
-        }
-        BigInteger x_abs = x;
-        x_abs.sign = Sign::plus;
-        std::string divisor = x_abs.toString();
-        std::string result;
-        sign = sign * x.sign;
-        if (sign == Sign::minus) result += '-';
-        sign = Sign::plus;
-        int degree = (a.size() - x.size() + 1) * base_len;
-        divisor += std::string(degree, '0');
-        BigInteger sub = divisor;
-        for (; degree >= 0; degree--) {
-            int number = 0;
-            for (; number < 9; number++) {
-                if (less_abs(*this, sub)) break;
-                *this -= sub;
-            }
-            result += char('0' + number);
-            div10(sub);
-        }
-        *this = result;
-        delete_trailing_zeroes(a);
-        if (is_zero()) sign = Sign::plus;
-        return *this;
-    }
+// how a Residue<N> keeps its value: every representation stores one uint64_t below N, maps 0 to 0 and
+// multiplies without a hardware division. This generic one is Barrett reduction on the residue itself.
+// Products of residues below 2^32 fit in 64 bits, where the compiler already turns % N into the same
+// multiplication by a reciprocal
+template<size_t N, typename = void>
+struct Representation {
+    static constexpr Barrett arithmetic = Barrett(N);
 
-    BigInteger& operator%=(const BigInteger& x) {
-        BigInteger copy = *this;
-        copy /= x;
-        copy *= x;
-        *this -= copy;
-        if (is_zero()) sign = Sign::plus;
-        return *this;
+    static uint64_t to(uint64_t x) {
+        return x;
     }
 
-    BigInteger& operator-=(const BigInteger& x) {
-        add_with_sign(x, Sign::minus);
-        return *this;
+    static uint64_t from(uint64_t x) {
+        return x;
     }
 
-    BigInteger& operator++() {
-        *this += 1;
-        return *this;
+    static uint64_t multiply(uint64_t x, uint64_t y) {
+        if constexpr (N <= (uint64_t(1) << 32)) return x * y % N;
+        else return arithmetic.multiply(x, y);
     }
 
-    BigInteger operator++(int) {
-        BigInteger copy = *this;
-        *this += 1;
-        return copy;
+    // the representation of a product whose factors were multiplied in this representation and reduced modulo N
+    static uint64_t from_product(uint64_t x) {
+        return x;
     }
+};
 
-    BigInteger& operator--() {
-        *this -= 1;
-        return *this;
+// arithmetic modulo an odd mod < 2^63 in Montgomery form: x is kept as x * 2^64 % mod, so a product only
+// needs the REDC step, which divides by 2^64 instead of mod. mod < 2^63 keeps the intermediate sum of REDC
+// within 128 bits
+class Montgomery {
+private:
+    static constexpr uint64_t inverse(uint64_t mod) {
+        uint64_t result = mod;
+        for (size_t i = 0; i < 5; i++) result *= 2 - mod * result;
+        return result;
     }
 
-    BigInteger operator--(int) {
-        BigInteger copy = *this;
-        *this -= 1;
-        return copy;
-    }
+public:
+    uint64_t mod;
+    // -mod^(-1) modulo 2^64 and 2^128 % mod
+    uint64_t negated_inverse;
+    uint64_t r_squared;
 
-    BigInteger operator-() const {
-        BigInteger copy = *this;
-        if (!copy.is_zero()) copy.sign = copy.sign * Sign::minus;
-        return copy;
-    }
+    constexpr explicit Montgomery(uint64_t mod)
+        : mod(mod), negated_inverse(-inverse(mod)),
+          r_squared(static_cast<uint64_t>((static_cast<wide>((wide(1) << 64) % mod) << 64) % mod)) {}
 
-    explicit operator bool() const {
-        return !(is_zero());
+    // x * 2^(-64) % mod for x < mod * 2^64
+    constexpr uint64_t redc(wide x) const {
+        uint64_t m = static_cast<uint64_t>(x) * negated_inverse;
+        uint64_t result = static_cast<uint64_t>((x + static_cast<wide>(m) * mod) >> 64);
+        return result >= mod ? result - mod : result;
     }
 
-    long long& operator[](size_t i) {
-        return a[i];
+    constexpr uint64_t to(uint64_t x) const {
+        return redc(static_cast<wide>(x) * r_squared);
     }
 
-    const long long& operator[](size_t i) const {
-        return a[i];
+    constexpr uint64_t from(uint64_t x) const {
+        return redc(x);
     }
 
-    const Sign& get_sign() const {
-        return sign;
+    constexpr uint64_t multiply(uint64_t x, uint64_t y) const {
+        return redc(static_cast<wide>(x) * y);
     }
 
-    void set_sign(Sign new_sign) {
-        sign = new_sign;
+    constexpr uint64_t add(uint64_t x, uint64_t y) const {
+        return x >= mod - y ? x - (mod - y) : x + y;
     }
 
-    bool is_zero() const {
-        return a.size() == 1 && a[0] == 0;
+    constexpr uint64_t subtract(uint64_t x, uint64_t y) const {
+        return x >= y ? x - y : x + (mod - y);
     }
 
-    bool is_one() const {
-        return a.size() == 1 && a[0] == 1;
+    constexpr uint64_t power(uint64_t x, uint64_t m) const {
+        uint64_t result = to(1);
+        for (; m; m >>= 1) {
+            if (m & 1) result = multiply(result, x);
+            x = multiply(x, x);
+        }
+        return result;
     }
 
-    size_t size() const {
-        return a.size();
+    // the inverse of x for a prime mod
+    constexpr uint64_t invert(uint64_t x) const {
+        return power(x, mod - 2);
     }
 };
 
-BigInteger gcd(BigInteger a, BigInteger b) {
-    while (b) {
-        a %= b;
-        std::swap(a, b);
-    }
-    return a;
-}
-
-bool operator==(const BigInteger& lhs, const BigInteger& rhs) {
-    if (lhs.get_sign() != rhs.get_sign()) return false;
-    if (lhs.size() != rhs.size()) return false;
-    for (size_t i = 0; i < lhs.size(); i++) {
-        if (lhs[i] != rhs[i]) return false;
+// one Miller-Rabin round set over the arithmetic m for modulus n: the first twelve primes as bases,
+// which is exact for every 64-bit n
+template<typename Arithmetic>
+constexpr bool miller_rabin(uint64_t n, const Arithmetic& m) {
+    const uint64_t bases[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+    uint64_t d = n - 1;
+    size_t s = 0;
+    for (; d % 2 == 0; d /= 2) s++;
+    const uint64_t one = m.to(1), minus_one = m.to(n - 1);
+    for (uint64_t a : bases) {
+        uint64_t x = m.power(m.to(a), d);
+        if (x == one || x == minus_one) continue;
+        size_t i = 1;
+        for (; i < s && x != minus_one; i++) x = m.multiply(x, x);
+        if (x != minus_one) return false;
     }
     return true;
 }
 
-bool operator!=(const BigInteger& lhs, const BigInteger& rhs) {
-    return !(lhs == rhs);
-}
-
-bool operator<(const BigInteger& lhs, const BigInteger& rhs) {
-    if (lhs.get_sign() != rhs.get_sign()) return lhs.get_sign() < rhs.get_sign();
-    if (lhs.size() != rhs.size()) return (lhs.get_sign() == Sign::minus) ^ (lhs.size() < rhs.size());
-    for (int i = lhs.size() - 1; i >= 0; i--) {
-        if (lhs[i] != rhs[i]) return (lhs.get_sign() == Sign::minus) ^ (lhs[i] < rhs[i]);
+// whether n is prime, also in constant expressions; Montgomery form serves odd n below 2^63, Barrett the rest
+constexpr bool is_prime(uint64_t n) {
+    const uint64_t small[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+    if (n < 2) return false;
+    for (uint64_t p : small) {
+        if (n % p == 0) return n == p;
     }
-    return false;
-}
-
-bool operator>(const BigInteger& lhs, const BigInteger& rhs) {
-    return rhs < lhs;
-}
-
-bool operator<=(const BigInteger& lhs, const BigInteger& rhs) {
-    return !(rhs < lhs);
-}
-
-bool operator>=(const BigInteger& lhs, const BigInteger& rhs) {
-    return !(lhs < rhs);
-}
-
-BigInteger operator*(const BigInteger& lhs, const BigInteger& rhs) {
-    BigInteger copy = lhs;
-    copy *= rhs;
-    return copy;
-}
-
-BigInteger operator+(const BigInteger& lhs, const BigInteger& rhs) {
-    BigInteger copy = lhs;
-    copy += rhs;
-    return copy;
-}
-
-BigInteger operator-(const BigInteger& lhs, const BigInteger& rhs) {
-    BigInteger copy = lhs;
-    copy -= rhs;
-    return copy;
-}
-
-BigInteger operator/(const BigInteger& lhs, const BigInteger& rhs) {
-    BigInteger copy = lhs;
-    copy /= rhs;
-    return copy;
-}
-
-BigInteger operator%(const BigInteger& lhs, const BigInteger& rhs) {
-    BigInteger copy = lhs;
-    copy %= rhs;
-    return copy;
-}
-
-std::ostream& operator<<(std::ostream& out, const BigInteger& a) {
-    out << a.toString();
-    return out;
-}
-
-std::istream& operator>>(std::istream& in, BigInteger& a) {
-    std::string s;
-    in >> s;
-    a = s;
-    return in;
+    return n < (uint64_t(1) << 63) ? miller_rabin(n, Montgomery(n)) : miller_rabin(n, Barrett(n));
 }
 
-class Rational {
-private:
-    BigInteger numerator;
-    BigInteger denominator;
-    Sign sign = Sign::plus;
-
-private:
-    bool is_zero() const {
-        return numerator.is_zero();
-    }
-
-    void normalize() {
-        sign = sign * numerator.get_sign();
-        numerator.set_sign(Sign::plus);
-        if (is_zero()) sign = Sign::plus;
-        BigInteger g = gcd(numerator, denominator);
-        if (g.is_one()) return;
-        numerator /= g;
-        denominator /= g;
-    }
-
-public:
-    Rational() : numerator(0), denominator(1), sign(Sign::plus) {}
-
-    Rational(int x) : numerator(x), denominator(1), sign(Sign::plus) {
-        sign = numerator.get_sign();
-        numerator.set_sign(Sign::plus);
-    }
-
-    Rational(const BigInteger& x) : numerator(x), denominator(1), sign(Sign::plus) {
-        sign = numerator.get_sign();
-        numerator.set_sign(Sign::plus);
-    }
-
-    Rational(const Rational& x) : numerator(x.numerator), denominator(x.denominator), sign(x.sign) {}
-
-    Rational& operator=(const Rational& x) {
-        numerator = x.numerator;
-        denominator = x.denominator;
-        sign = x.sign;
-        return *this;
-    }
-
-    std::string toString() const {
-        std::string res;
-        if (sign == Sign::minus) res += '-';
-        res += numerator.toString();
-        if (!denominator.is_one()) {
-            res += '/';
-            res += denominator.toString();
-        }
-        return res;
-    }
-
-    Rational& operator*=(const Rational& x) {
-        numerator *= x.numerator;
-        denominator *= x.denominator;
-        sign = sign * x.sign;
-        normalize();
-        return *this;
-    }
-
-    Rational& operator+=(const Rational& x) {
-        numerator.set_sign(sign);
-        sign = Sign::plus;
-        numerator *= x.denominator;
-        if (x.sign == Sign::plus) numerator += x.numerator * denominator;
-        else numerator -= x.numerator * denominator;
-        denominator *= x.denominator;
-        normalize();
-        return *this;
-    }
-
-    Rational& operator-=(const Rational& x) {
-        numerator.set_sign(sign);
-        sign = Sign::plus;
-        numerator *= x.denominator;
-        if (x.sign == Sign::plus) numerator -= x.numerator * denominator;
-        else numerator += x.numerator * denominator;
-        denominator *= x.denominator;
-        normalize();
-        return *this;
-    }
-
-    Rational& operator/=(const Rational& x) {
-        numerator *= x.denominator;
-        denominator *= x.numerator;
-        sign = sign * x.sign;
-        normalize();
-        return *this;
-    }
-
-    Rational operator-() const {
-        Rational copy = *this;
-        copy.sign = copy.sign * Sign::minus;
-        copy.normalize();
-        return copy;
-    }
-
-    std::string asDecimal(size_t precision = 0) const {
-        BigInteger result = numerator * std::string("1" + std::string(precision, '0'));
-        result /= denominator;
-        std::string decimal = result.toString();
-        int pos = std::max(static_cast<int>(0), static_cast<int>(decimal.size() - precision));
-        return (sign == Sign::minus ? std::string("-") : std::string(""))
-               + (pos == 0 ? std::string("0") : std::string(""))
-               + decimal.substr(0, pos) + "." + std::string(precision - (decimal.size() - pos), '0')
-               + decimal.substr(pos, precision);
-    }
+// Montgomery form for odd N above 2^32, where the compiler could not turn % N into a multiplication
+template<size_t N>
+struct Representation<N, std::enable_if_t<N % 2 == 1 && (uint64_t(1) << 32) < N && N < (uint64_t(1) << 63)>> {
+    static constexpr Montgomery arithmetic = Montgomery(N);
 
-    explicit operator bool() const {
-        return !(is_zero());
+    static uint64_t to(uint64_t x) {
+        return arithmetic.to(x);
     }
 
-    explicit operator double() const {
-        return stod(asDecimal(30));
+    static uint64_t from(uint64_t x) {
+        return arithmetic.from(x);
     }
 
-    const Sign& get_sign() const {
-        return sign;
+    static uint64_t multiply(uint64_t x, uint64_t y) {
+        return arithmetic.multiply(x, y);
     }
 
-    const BigInteger& get_numerator() const {
-        return numerator;
+    static uint64_t from_product(uint64_t x) {
+        return arithmetic.from(x);
     }
-
-    const BigInteger& get_denominator() const {
-        return denominator;
+};
+// how far sums of products of residues modulo mod may grow before they have to be reduced. While mod is at
+// most 2^32 a sum is kept in 64 bits and folded as hi * (2^32 % mod) + lo, which needs no division and keeps
+// it below fold_bound; folded_steps products fit on top of that before the next fold. Bigger moduli are
+// summed in 128 bits and reduced after every wide_steps products
+struct ResidueReduction {
+    static constexpr uint64_t low_mask = (uint64_t(1) << 32) - 1;
+
+    uint64_t mod;
+    wide max_product;
+    bool narrow;
+    uint64_t fold_factor;
+    uint64_t fold_bound;
+    size_t folded_steps;
+    size_t wide_steps;
+    bool folded;
+
+    constexpr explicit ResidueReduction(uint64_t mod)
+        : mod(mod), max_product(wide(mod - 1) * (mod - 1)), narrow(mod <= (uint64_t(1) << 32)),
+          fold_factor(narrow ? (uint64_t(1) << 32) % mod : 0), fold_bound(low_mask * fold_factor + low_mask),
+          folded_steps(narrow ? steps(UINT64_MAX - fold_bound) : 0), wide_steps(steps(~wide(0) - (mod - 1))),
+          folded(folded_steps > 0) {}
+
+    constexpr size_t steps(wide room) const {
+        if (max_product == 0) return SIZE_MAX;
+        return room / max_product > SIZE_MAX ? SIZE_MAX : static_cast<size_t>(room / max_product);
+    }
+
+    // the number of products to add before the next reduction
+    constexpr size_t reduce_steps() const {
+        return folded ? folded_steps : wide_steps;
     }
 };
-
-bool operator==(const Rational& lhs, const Rational& rhs) {
-    if (lhs.get_sign() != rhs.get_sign()) return false;
-    return lhs.get_numerator() == rhs.get_numerator() && lhs.get_denominator() == rhs.get_denominator();
-}
-
-bool operator!=(const Rational& lhs, const Rational& rhs) {
-    return !(lhs == rhs);
 }
 
-bool operator<(const Rational& lhs, const Rational& rhs) {
-    if (lhs.get_sign() != rhs.get_sign()) return lhs.get_sign() < rhs.get_sign();
-    return (lhs.get_sign() == Sign::minus) 
-            ^ (lhs.get_numerator() * rhs.get_denominator() < rhs.get_numerator() * lhs.get_denominator());
-}
-
-bool operator>(const Rational& lhs, const Rational& rhs) {
-    return rhs < lhs;
-}
-
-bool operator<=(const Rational& lhs, const Rational& rhs) {
-    return !(rhs < lhs);
-}
-
-bool operator>=(const Rational& lhs, const Rational& rhs) {
-    return !(lhs < rhs);
-}
-
-Rational operator*(const Rational& lhs, const Rational& rhs) {
-    Rational copy = lhs;
-    copy *= rhs;
-    return copy;
-}
-
-Rational operator+(const Rational& lhs, const Rational& rhs) {
-    Rational copy = lhs;
-    copy += rhs;
-    return copy;
-}
-
-Rational operator-(const Rational& lhs, const Rational& rhs) {
-    Rational copy = lhs;
-    copy -= rhs;
-    return copy;
-}
-
-Rational operator/(const Rational& lhs, const Rational& rhs) {
-    Rational copy = lhs;
-    copy /= rhs;
-    return copy;
-}
-
-std::ostream& operator<<(std::ostream& out, const Rational& a) {
-    out << a.toString();
-    return out;
-}
-
-std::istream& operator>>(std::istream& in, Rational& a) {
-    std::string s;
-    in >> s;
-    a = Rational(s);
-    return in;
-}
-}
-
-template<int N, int D, bool fl>
-struct IsPrimeHelper {
-    static const bool value = N % D != 0 && IsPrimeHelper<N, D + 1, (D + 1) * (D + 1) <= N>::value; 
-};
-
-template<int N, int D>
-struct IsPrimeHelper<N, D, false> {
-    static const bool value = true;
-};
-
-template<int N>
-struct IsPrime {
-    static const bool prime = IsPrimeHelper<N, 2, 2 * 2 <= N>::value;
-};
-
-template<>
-struct IsPrime<1> {
-    static const bool prime = false;
-};
-
 template<size_t M, size_t N, typename T>
 class Matrix;
 
+namespace Kernel {
+template<typename Field, typename = void>
+struct Traits;
+}
+
 template<size_t N>
 class Residue {
 private:
+    using Representation = Modular::Representation<N>;
+
+    // the residue in Representation, which needs no division to multiply
     size_t value;
 
 private:
@@ -657,17 +284,18 @@ private:
         return bin_pow(x, N - 2);
     }
 
+    template<typename Field, typename>
+    friend struct Kernel::Traits;
+
 public:
     Residue() : value(0) {}
 
-    Residue(int x) : value((x % (int) N + N) % N) {}
+    Residue(int x) : value(Representation::to(x < 0 ? (N - static_cast<size_t>(-static_cast<long long>(x)) % N) % N
+                                                    : static_cast<size_t>(x) % N)) {}
 
-    Residue(const Residue<N>& x) : value(x.value) {}
+    Residue(const Residue<N>& x) = default;
 
-    Residue<N>& operator=(const Residue<N>& x) {
-        value = x.value;
-        return *this;
-    }
+    Residue<N>& operator=(const Residue<N>& x) = default;
 
     Residue<N>& operator=(int x) {
         Residue<N> copy = x;
@@ -676,23 +304,23 @@ public:
     }
 
     Residue<N>& operator+=(const Residue<N>& x) {
-        value = (value + x.value) % N;
+        value = value >= N - x.value ? value - (N - x.value) : value + x.value;
         return *this;
     }
 
     Residue<N>& operator-=(const Residue<N>& x) {
-        value = (value - x.value + N) % N;
+        value = value >= x.value ? value - x.value : value + (N - x.value);
         return *this;
     }
 
     Residue<N>& operator*=(const Residue<N>& x) {
-        value = static_cast<long long>(value * x.value) % N;
+        value = Representation::multiply(value, x.value);
         return *this;
     }
 
     Residue<N>& operator/=(const Residue<N>& x) {
-        static_assert(IsPrime<N>::prime);
-        value = static_cast<long long>(value * inv(x).value) % N;
+        static_assert(Modular::is_prime(N), "Residues can only be divided modulo a prime");
+        value = Representation::multiply(value, inv(x).value);
         return *this;
     }
 
@@ -719,29 +347,29 @@ public:
     }
 
     Residue<N> operator-() const {
-        Residue<N> copy = *this;
-        copy *= -1;
+        Residue<N> copy;
+        copy -= *this;
         return copy;
     }
 
     explicit operator int() const {
-        return value;
+        return Representation::from(value);
     }
 
     explicit operator bool() const {
         return value != 0;
     }
 
-    const size_t& get_value() const {
-        return value;
+    size_t get_value() const {
+        return Representation::from(value);
     }
     
     bool operator==(const Residue<N>& rhs) const {
-        return get_value() == rhs.get_value();
+        return value == rhs.value;
     }
 
     bool operator!=(const Residue<N>& rhs) const {
-        return get_value() != rhs.get_value();
+        return value != rhs.value;
     }
 };
 
@@ -798,128 +426,1480 @@ std::istream& operator>>(std::istream& in, Residue<N>& a) {
     return in;
 }
 
-namespace Row {
+// a residue modulo a number chosen at run time, as read from input. The modulus belongs to the thread:
+// set_modulus sets it for the calling thread only, so threads may work modulo different numbers at once,
+// and on one thread it may only change while none of its residues is in use. The parallel matrix algorithms
+// run their tasks under the modulus of the thread that started them. It is kept on the residues themselves
+// and reduced by Barrett's method, so any modulus from 1 to 2^64 - 1 works, and the matrix kernels sum
+// products exactly as for Residue<N>
+class DynResidue {
+private:
+    struct Modulus {
+        Modular::Barrett arithmetic;
+        Modular::ResidueReduction reduction;
+    };
+
+    static inline thread_local Modulus modulus = {Modular::Barrett(1), Modular::ResidueReduction(1)};
+
+    uint64_t value;
 
-template<size_t N, typename Field = BigNumber::Rational>
-class Row {
 private:
-    std::vector<Field> a = std::vector<Field>(N);
+    // the inverse of x by the extended Euclidean algorithm, the coefficients kept modulo the modulus
+    static uint64_t inverse(uint64_t x) {
+        const Modular::Barrett& m = modulus.arithmetic;
+        uint64_t a = m.mod, b = x;
+        // a = u * x and b = v * x modulo m.mod
+        uint64_t u = 0, v = 1;
+        while (b) {
+            uint64_t q = a / b;
+            a -= q * b;
+            u = m.subtract(u, m.multiply(q % m.mod, v));
+            std::swap(a, b);
+            std::swap(u, v);
+        }
+        return u;
+    }
+
+    template<typename Field, typename>
+    friend struct Kernel::Traits;
 
 public:
-    Field& operator[](size_t i) {
-        return a[i];
+    static void set_modulus(uint64_t mod) {
+        modulus = {Modular::Barrett(mod), Modular::ResidueReduction(mod)};
     }
 
-    const Field& operator[](size_t i) const {
-        return a[i];
+    static uint64_t get_modulus() {
+        return modulus.arithmetic.mod;
     }
 
-    std::vector<Field> getRow() const {
-        return a;
-    }
-};
-}
+    // sets the modulus of the calling thread for its lifetime and then restores the previous one
+    class ModulusScope {
+    private:
+        Modulus saved;
 
-template<size_t M, size_t N, typename Field = BigNumber::Rational> 
-class Matrix {
-private:
-    std::vector<Row::Row<N, Field>> a = std::vector<Row::Row<N, Field>>(M);
+    public:
+        explicit ModulusScope(uint64_t mod) : saved(modulus) {
+            set_modulus(mod);
+        }
 
-private:
-    template<size_t K>
-    static size_t get_first_nonzero_pos(Row::Row<K, Field>& a) {
-        for (size_t i = 0; i < N; i++) {
-            if (a[i]) return i;
+        ModulusScope(const ModulusScope&) = delete;
+
+        ModulusScope& operator=(const ModulusScope&) = delete;
+
+        ~ModulusScope() {
+            modulus = saved;
         }
-        return N;
-    }
+    };
+
+    DynResidue() : value(0) {}
 
-    template<size_t K>
-    static bool is_zero(Row::Row<K, Field>& a) {
-        return get_first_nonzero_pos(a) == K;
+    DynResidue(long long x) {
+        uint64_t mod = get_modulus();
+        value = x < 0 ? (mod - static_cast<uint64_t>(-(x + 1)) % mod - 1) % mod : static_cast<uint64_t>(x) % mod;
     }
 
-    template<size_t K>
-    static void subtract_row(Row::Row<K, Field>& a, const Row::Row<K, Field>& b, const Field mul_number) {
-        for (size_t i = 0; i < K; i++) {
-            a[i] -= b[i] * mul_number;
-        }
+    DynResidue(const DynResidue& x) = default;
+
+    DynResidue& operator=(const DynResidue& x) = default;
+
+    DynResidue& operator+=(const DynResidue& x) {
+        value = modulus.arithmetic.add(value, x.value);
+        return *this;
     }
 
-    template<size_t K>
-    static void div_row(Row::Row<K, Field>& a, const Field div_number) {
-        for (size_t i = 0; i < K; i++) {
-            a[i] /= div_number;
-        }
+    DynResidue& operator-=(const DynResidue& x) {
+        value = modulus.arithmetic.subtract(value, x.value);
+        return *this;
     }
 
-public:
-    Matrix() {
-        if (M == N) {
-            for (size_t i = 0; i < M; i++) {
-                a[i][i] = 1;
-            }
-        }
+    DynResidue& operator*=(const DynResidue& x) {
+        value = modulus.arithmetic.multiply(value, x.value);
+        return *this;
     }
 
-    Matrix(const std::initializer_list<std::initializer_list<int>> x) {
-        size_t cur = 0;
-        for (auto i = x.begin(); i != x.end(); i++) {
-            for (auto j = i->begin(); j != i->end(); j++, cur++) {
-                a[cur / N][cur % N] = *j;
-            }
-        }
+    // x has to be coprime to the modulus
+    DynResidue& operator/=(const DynResidue& x) {
+        value = modulus.arithmetic.multiply(value, inverse(x.value));
+        return *this;
     }
 
-    Matrix(const Matrix<M, N, Field>& x) {
-        for (size_t i = 0; i < M; i++) {
-            for (size_t j = 0; j < N; j++) {
-                a[i][j] = x[i][j];
+    DynResidue& operator++() {
+        *this += 1;
+        return *this;
+    }
+
+    DynResidue operator++(int) {
+        DynResidue copy = *this;
+        *this += 1;
+        return copy;
+    }
+
+    DynResidue& operator--() {
+        *this -= 1;
+        return *this;
+    }
+
+    DynResidue operator--(int) {
+        DynResidue copy = *this;
+        *this -= 1;
+        return copy;
+    }
+
+    DynResidue operator-() const {
+        DynResidue copy;
+        copy -= *this;
+        return copy;
+    }
+
+    explicit operator int() const {
+        return static_cast<int>(value);
+    }
+
+    explicit operator bool() const {
+        return value != 0;
+    }
+
+    uint64_t get_value() const {
+        return value;
+    }
+
+    bool operator==(const DynResidue& rhs) const {
+        return value == rhs.value;
+    }
+
+    bool operator!=(const DynResidue& rhs) const {
+        return value != rhs.value;
+    }
+};
+
+inline DynResidue operator+(const DynResidue& lhs, const DynResidue& rhs) {
+    DynResidue copy = lhs;
+    copy += rhs;
+    return copy;
+}
+
+inline DynResidue operator-(const DynResidue& lhs, const DynResidue& rhs) {
+    DynResidue copy = lhs;
+    copy -= rhs;
+    return copy;
+}
+
+inline DynResidue operator*(const DynResidue& lhs, const DynResidue& rhs) {
+    DynResidue copy = lhs;
+    copy *= rhs;
+    return copy;
+}
+
+inline DynResidue operator/(const DynResidue& lhs, const DynResidue& rhs) {
+    DynResidue copy = lhs;
+    copy /= rhs;
+    return copy;
+}
+
+inline std::ostream& operator<<(std::ostream& out, const DynResidue& a) {
+    out << a.get_value();
+    return out;
+}
+
+inline std::istream& operator>>(std::istream& in, DynResidue& a) {
+    long long x;
+    in >> x;
+    a = x;
+    return in;
+}
+
+// Parallel::parallel_for over a loop that computes with entries of Field. The modulus of DynResidue belongs
+// to a thread, so its tasks run under the modulus of the calling thread
+template<typename Field, typename Function>
+void parallel_for_entries(size_t begin, size_t end, size_t grain, Function f) {
+    if constexpr (std::is_same<Field, DynResidue>::value) {
+        uint64_t mod = DynResidue::get_modulus();
+        Parallel::parallel_for(begin, end, grain, [&](size_t first, size_t last) {
+            DynResidue::ModulusScope scope(mod);
+            f(first, last);
+        });
+    } else {
+        Parallel::parallel_for(begin, end, grain, f);
+    }
+}
+
+namespace Row {
+
+// a view of the N consecutive entries of one row of a row-major matrix
+template<size_t N, typename Field = BigNumber::Rational>
+class Row {
+private:
+    Field* a;
+
+public:
+    explicit Row(Field* a) : a(a) {}
+
+    template<typename Other, typename = std::enable_if_t<std::is_same<const Other, Field>::value>>
+    Row(const Row<N, Other>& x) : a(x.begin()) {}
+
+    Field& operator[](size_t i) const {
+        return a[i];
+    }
+
+    Field* begin() const {
+        return a;
+    }
+
+    Field* end() const {
+        return a + N;
+    }
+
+    std::vector<std::remove_const_t<Field>> getRow() const {
+        return std::vector<std::remove_const_t<Field>>(a, a + N);
+    }
+};
+
+// a view of the M entries of one column of a row-major matrix, stride entries apart
+template<size_t M, typename Field = BigNumber::Rational>
+class Column {
+private:
+    Field* a;
+    size_t stride;
+
+public:
+    class iterator {
+    private:
+        Field* p;
+        size_t stride;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::remove_const_t<Field>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = Field*;
+        using reference = Field&;
+
+        iterator(Field* p, size_t stride) : p(p), stride(stride) {}
+
+        Field& operator*() const {
+            return *p;
+        }
+
+        iterator& operator++() {
+            p += stride;
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator copy = *this;
+            p += stride;
+            return copy;
+        }
+
+        bool operator==(const iterator& x) const {
+            return p == x.p;
+        }
+
+        bool operator!=(const iterator& x) const {
+            return p != x.p;
+        }
+    };
+
+    Column(Field* a, size_t stride) : a(a), stride(stride) {}
+
+    Field& operator[](size_t i) const {
+        return a[i * stride];
+    }
+
+    iterator begin() const {
+        return iterator(a, stride);
+    }
+
+    iterator end() const {
+        return iterator(a + M * stride, stride);
+    }
+
+    std::vector<std::remove_const_t<Field>> getColumn() const {
+        return std::vector<std::remove_const_t<Field>>(begin(), end());
+    }
+};
+
+// matrices up to this many bytes of trivially copyable entries keep them inside the object
+static constexpr size_t inline_matrix_bytes = 4096;
+
+// allocates blocks aligned to a cache line, so that rows can be loaded with aligned vector instructions
+template<typename T>
+struct AlignedAllocator {
+    using value_type = T;
+    static constexpr size_t alignment = 64;
+
+    AlignedAllocator() = default;
+
+    template<typename U>
+    AlignedAllocator(const AlignedAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(alignment)));
+    }
+
+    void deallocate(T* p, size_t) {
+        ::operator delete(p, std::align_val_t(alignment));
+    }
+
+    template<typename U>
+    bool operator==(const AlignedAllocator<U>&) const {
+        return true;
+    }
+
+    template<typename U>
+    bool operator!=(const AlignedAllocator<U>&) const {
+        return false;
+    }
+};
+
+// the M * N entries of a matrix as one row-major block: a std::array for small trivially copyable fields,
+// a single aligned heap block otherwise
+template<size_t M, size_t N, typename Field>
+using Storage = std::conditional_t<std::is_trivially_copyable<Field>::value && M * N * sizeof(Field) <= inline_matrix_bytes,
+                                   std::array<Field, M * N>, std::vector<Field, AlignedAllocator<Field>>>;
+}
+
+namespace Modular {
+
+// the first count primes below 2^62 from the top down, found once for all callers
+inline std::vector<uint64_t> primes(size_t count) {
+    static std::mutex mutex;
+    static std::vector<uint64_t> found;
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t candidate = found.empty() ? (uint64_t(1) << 62) - 1 : found.back() - 2;
+    for (; found.size() < count; candidate -= 2) {
+        if (is_prime(candidate)) found.push_back(candidate);
+    }
+    return std::vector<uint64_t>(found.begin(), found.begin() + count);
+}
+
+using IntegerRows = std::vector<std::vector<BigNumber::BigInteger>>;
+
+// a single limb holds the whole value
+inline BigNumber::BigInteger to_integer(uint64_t x) {
+    BigNumber::BigInteger result = 0;
+    result[0] = x;
+    return result;
+}
+
+// log2 |x| within a tiny error; x must not be zero
+inline double log2_abs(const BigNumber::BigInteger& x) {
+    size_t n = x.size();
+    double top = x[n - 1] + (n > 1 ? std::ldexp(static_cast<double>(x[n - 2]), -64) : 0);
+    return std::log2(top) + (n - 1) * 64.0;
+}
+
+// log2 of Hadamard's bound on |det x| and on every minor of x: the product of the Euclidean lengths of
+// the rows, none of which is below one. A zero row makes the determinant zero, and the bound 1
+inline double hadamard_bits(const IntegerRows& x) {
+    double bits = 0;
+    for (const auto& row : x) {
+        double top = -1;
+        for (const auto& entry : row) {
+            if (entry) top = std::max(top, log2_abs(entry));
+        }
+        if (top < 0) return 0;
+        double sum = 0;
+        for (const auto& entry : row) {
+            if (entry) sum += std::exp2(2 * (log2_abs(entry) - top));
+        }
+        bits += top + 0.5 * std::log2(sum);
+    }
+    return bits;
+}
+
+// the number of primes whose product exceeds 2 * 2^bits, so that every integer of at most bits bits is
+// told apart from the others by its residues, with room for rounding in the estimate of bits
+inline size_t primes_for(double bits) {
+    return static_cast<size_t>((bits + 2) / 61) + 1;
+}
+
+// x % m.mod in Montgomery form, from the 64-bit limbs of x
+inline uint64_t image(const BigNumber::BigInteger& x, const Montgomery& m) {
+    uint64_t result = 0;
+    for (size_t i = x.size(); i-- > 0;) {
+        result = static_cast<uint64_t>(((static_cast<wide>(result) << 64) | x[i]) % m.mod);
+    }
+    if (x.get_sign() == BigNumber::Sign::minus && result) result = m.mod - result;
+    return m.to(result);
+}
+
+// Gauss-Jordan elimination of x modulo a prime, in Montgomery form; returns det x % mod. With adjugate,
+// also stores the adjugate det(x) * x^(-1) % mod there, row by row, unless the determinant is zero
+inline uint64_t eliminate(const IntegerRows& x, const Montgomery& m, std::vector<uint64_t>* adjugate) {
+    size_t n = x.size();
+    size_t width = adjugate ? 2 * n : n;
+    std::vector<uint64_t> a(n * width, 0);
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < n; j++) a[i * width + j] = image(x[i][j], m);
+        if (adjugate) a[i * width + n + i] = m.to(1);
+    }
+    uint64_t det = m.to(1);
+    bool negate = false;
+    for (size_t k = 0; k < n; k++) {
+        size_t p = k;
+        while (p < n && !a[p * width + k]) p++;
+        if (p == n) return 0;
+        if (p != k) {
+            std::swap_ranges(a.begin() + p * width, a.begin() + (p + 1) * width, a.begin() + k * width);
+            negate = !negate;
+        }
+        uint64_t* pivot_row = a.data() + k * width;
+        det = m.multiply(det, pivot_row[k]);
+        uint64_t inverse = m.invert(pivot_row[k]);
+        for (size_t q = k; q < width; q++) pivot_row[q] = m.multiply(pivot_row[q], inverse);
+        for (size_t i = adjugate ? 0 : k + 1; i < n; i++) {
+            uint64_t* row = a.data() + i * width;
+            uint64_t factor = row[k];
+            if (i == k || !factor) continue;
+            for (size_t q = k; q < width; q++) row[q] = m.subtract(row[q], m.multiply(factor, pivot_row[q]));
+        }
+    }
+    if (negate) det = m.subtract(0, det);
+    if (adjugate) {
+        adjugate->resize(n * n);
+        for (size_t i = 0; i < n; i++) {
+            for (size_t j = 0; j < n; j++) (*adjugate)[i * n + j] = m.from(m.multiply(det, a[i * width + n + j]));
+        }
+    }
+    return m.from(det);
+}
+
+// the integer in (-M / 2, M / 2] with given residues modulo primes of product M, by Garner's mixed radix form
+class ChineseRemainder {
+private:
+    std::vector<uint64_t> primes;
+    // (p_0 * ... * p_(i - 1))^(-1) % p_i
+    std::vector<uint64_t> inverses;
+    BigNumber::BigInteger product = 1;
+    BigNumber::BigInteger half;
+
+public:
+    explicit ChineseRemainder(const std::vector<uint64_t>& primes) : primes(primes), inverses(primes.size()) {
+        for (size_t i = 0; i < primes.size(); i++) {
+            Montgomery m(primes[i]);
+            uint64_t prefix = m.to(1);
+            for (size_t j = 0; j < i; j++) prefix = m.multiply(prefix, m.to(primes[j] % primes[i]));
+            inverses[i] = m.from(m.invert(prefix));
+            product *= to_integer(primes[i]);
+        }
+        half = product / 2;
+    }
+
+    // residues[i * stride] is the residue modulo primes[i]
+    BigNumber::BigInteger value(const uint64_t* residues, size_t stride) const {
+        size_t k = primes.size();
+        std::vector<uint64_t> digits(k);
+        for (size_t i = 0; i < k; i++) {
+            uint64_t p = primes[i];
+            uint64_t known = 0;
+            for (size_t j = i; j-- > 0;) {
+                known = static_cast<uint64_t>((static_cast<wide>(known) * (primes[j] % p) + digits[j] % p) % p);
+            }
+            uint64_t r = residues[i * stride];
+            uint64_t difference = r >= known ? r - known : r + (p - known);
+            digits[i] = static_cast<uint64_t>(static_cast<wide>(difference) * inverses[i] % p);
+        }
+        BigNumber::BigInteger result = 0;
+        for (size_t i = k; i-- > 0;) {
+            result *= to_integer(primes[i]);
+            result += to_integer(digits[i]);
+        }
+        if (half < result) result -= product;
+        return result;
+    }
+};
+
+// det x for a square integer matrix, from its images modulo as many primes as Hadamard's bound asks for,
+// eliminated in parallel
+inline BigNumber::BigInteger determinant(const IntegerRows& x) {
+    std::vector<uint64_t> moduli = primes(primes_for(hadamard_bits(x)));
+    std::vector<uint64_t> residues(moduli.size());
+    Parallel::parallel_for(0, moduli.size(), 1, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) residues[i] = eliminate(x, Montgomery(moduli[i]), nullptr);
+    });
+    return ChineseRemainder(moduli).value(residues.data(), 1);
+}
+
+// det x, and the adjugate det(x) * x^(-1) in adjugate unless x is singular. The entries of the adjugate
+// are minors of x, so the primes that pin down the determinant pin them down too; primes dividing the
+// determinant are replaced, and once more of them turn up than a nonzero determinant has factors of
+// their size, it is zero
+inline BigNumber::BigInteger adjugate(const IntegerRows& x, IntegerRows& adjugate) {
+    size_t n = x.size();
+    double bits = hadamard_bits(x);
+    size_t needed = primes_for(bits);
+    std::vector<uint64_t> moduli;
+    std::vector<uint64_t> dets;
+    std::vector<std::vector<uint64_t>> images;
+    size_t tried = 0;
+    while (moduli.size() < needed) {
+        if (tried - moduli.size() > bits / 61) return 0;
+        std::vector<uint64_t> batch = primes(tried + needed - moduli.size());
+        batch.erase(batch.begin(), batch.begin() + tried);
+        std::vector<std::vector<uint64_t>> batch_images(batch.size());
+        std::vector<uint64_t> batch_dets(batch.size());
+        Parallel::parallel_for(0, batch.size(), 1, [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; i++) batch_dets[i] = eliminate(x, Montgomery(batch[i]), &batch_images[i]);
+        });
+        for (size_t i = 0; i < batch.size(); i++) {
+            if (!batch_dets[i]) continue;
+            moduli.push_back(batch[i]);
+            dets.push_back(batch_dets[i]);
+            images.push_back(std::move(batch_images[i]));
+        }
+        tried += batch.size();
+    }
+    // residues[(i * n + j) * k + t] is adjugate[i][j] modulo moduli[t]
+    size_t k = moduli.size();
+    std::vector<uint64_t> residues(n * n * k);
+    for (size_t t = 0; t < k; t++) {
+        for (size_t e = 0; e < n * n; e++) residues[e * k + t] = images[t][e];
+    }
+    ChineseRemainder crt(moduli);
+    adjugate.assign(n, std::vector<BigNumber::BigInteger>(n));
+    Parallel::parallel_for(0, n, 1, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            for (size_t j = 0; j < n; j++) adjugate[i][j] = crt.value(residues.data() + (i * n + j) * k, 1);
+        }
+    });
+    return crt.value(dets.data(), 1);
+}
+}
+
+namespace Kernel {
+
+static constexpr size_t l1_bytes = 32 * 1024;
+static constexpr size_t l2_bytes = 1024 * 1024;
+static constexpr size_t max_panel_columns = 4096;
+
+// how entries of one Field are packed and multiplied in register tiles of mr x nr entries of the product.
+// This generic version packs pointers, so that big entries are never copied, and sums each entry of the
+// product in one BigNumber::ProductSum over the whole inner dimension, so it is normalized only once
+template<typename Field, typename>
+struct Traits {
+    using Packed = const Field*;
+    static constexpr size_t mr = 2;
+    static constexpr size_t nr = 2;
+    // whether the inner dimension may be cut into blocks whose partial products are added up in c
+    static constexpr bool split_inner = false;
+    // the size above which square products of exact fields recurse with Strassen-Winograd, trading one
+    // product of half the size for 15 additions
+    static constexpr size_t strassen_threshold = 256;
+
+    static Packed pack(const Field* x) {
+        return x;
+    }
+
+    static Packed padding() {
+        static const Field zero = 0;
+        return &zero;
+    }
+
+    static void micro_kernel(size_t kc, const Packed* a, const Packed* b, Field* c, size_t ldc,
+                             size_t rows, size_t cols, bool accumulate) {
+        BigNumber::ProductSum<Field> sums[mr][nr];
+        for (size_t p = 0; p < kc; p++, a += mr, b += nr) {
+            for (size_t i = 0; i < mr; i++) {
+                for (size_t j = 0; j < nr; j++) {
+                    sums[i][j].add(*a[i], *b[j]);
+                }
+            }
+        }
+        for (size_t i = 0; i < rows; i++) {
+            for (size_t j = 0; j < cols; j++) {
+                if (accumulate) c[i * ldc + j] += sums[i][j].value();
+                else c[i * ldc + j] = sums[i][j].value();
             }
         }
     }
+};
+
+// built-in types are packed by value and the whole tile of sums stays in registers
+template<typename Field>
+struct Traits<Field, std::enable_if_t<std::is_arithmetic<Field>::value>> {
+    using Packed = Field;
+    static constexpr size_t mr = 4;
+    static constexpr size_t nr = 8;
+    static constexpr bool split_inner = true;
+    // floating point products would lose accuracy, and integer ones gain little
+    static constexpr size_t strassen_threshold = SIZE_MAX;
+
+    static Packed pack(const Field* x) {
+        return *x;
+    }
+
+    static Packed padding() {
+        return 0;
+    }
+
+    static void micro_kernel(size_t kc, const Packed* a, const Packed* b, Field* c, size_t ldc,
+                             size_t rows, size_t cols, bool accumulate) {
+        Field sums[mr][nr] = {};
+        for (size_t p = 0; p < kc; p++, a += mr, b += nr) {
+            for (size_t i = 0; i < mr; i++) {
+                for (size_t j = 0; j < nr; j++) {
+                    sums[i][j] += a[i] * b[j];
+                }
+            }
+        }
+        for (size_t i = 0; i < rows; i++) {
+            for (size_t j = 0; j < cols; j++) {
+                if (accumulate) c[i * ldc + j] += sums[i][j];
+                else c[i * ldc + j] = sums[i][j];
+            }
+        }
+    }
+};
+
+// adds products of the next steps packed columns of a and rows of b to a tile of sums of residues, with
+// vector instructions while the sums are 64-bit and the residues below 2^32
+// GCC 12 flags the undefined passthrough vector inside _mm512_mul_epu32 as maybe uninitialized once the
+// intrinsic is inlined here, a false positive of the intrinsic header
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+template<size_t mr, size_t nr, typename Sum>
+void add_products(size_t steps, const uint64_t*& a, const uint64_t*& b, Sum (&sums)[mr][nr]) {
+#if defined(__AVX512F__)
+    if constexpr (std::is_same<Sum, uint64_t>::value && nr % 8 == 0) {
+        constexpr size_t vectors = nr / 8;
+        __m512i tile[mr][vectors];
+        for (size_t i = 0; i < mr; i++) {
+            for (size_t v = 0; v < vectors; v++) tile[i][v] = _mm512_loadu_si512(sums[i] + 8 * v);
+        }
+        for (size_t p = 0; p < steps; p++, a += mr, b += nr) {
+            __m512i row[vectors];
+            for (size_t v = 0; v < vectors; v++) row[v] = _mm512_load_si512(b + 8 * v);
+            for (size_t i = 0; i < mr; i++) {
+                __m512i x = _mm512_set1_epi64(a[i]);
+                for (size_t v = 0; v < vectors; v++) tile[i][v] = _mm512_add_epi64(tile[i][v], _mm512_mul_epu32(x, row[v]));
+            }
+        }
+        for (size_t i = 0; i < mr; i++) {
+            for (size_t v = 0; v < vectors; v++) _mm512_storeu_si512(sums[i] + 8 * v, tile[i][v]);
+        }
+        return;
+    }
+#elif defined(__AVX2__)
+    if constexpr (std::is_same<Sum, uint64_t>::value && nr % 4 == 0) {
+        constexpr size_t vectors = nr / 4;
+        __m256i tile[mr][vectors];
+        for (size_t i = 0; i < mr; i++) {
+            for (size_t v = 0; v < vectors; v++) tile[i][v] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(sums[i] + 4 * v));
+        }
+        for (size_t p = 0; p < steps; p++, a += mr, b += nr) {
+            __m256i row[vectors];
+            for (size_t v = 0; v < vectors; v++) row[v] = _mm256_load_si256(reinterpret_cast<const __m256i*>(b + 4 * v));
+            for (size_t i = 0; i < mr; i++) {
+                __m256i x = _mm256_set1_epi64x(a[i]);
+                for (size_t v = 0; v < vectors; v++) tile[i][v] = _mm256_add_epi64(tile[i][v], _mm256_mul_epu32(x, row[v]));
+            }
+        }
+        for (size_t i = 0; i < mr; i++) {
+            for (size_t v = 0; v < vectors; v++) _mm256_storeu_si256(reinterpret_cast<__m256i*>(sums[i] + 4 * v), tile[i][v]);
+        }
+        return;
+    }
+#endif
+    for (size_t p = 0; p < steps; p++, a += mr, b += nr) {
+        for (size_t i = 0; i < mr; i++) {
+            for (size_t j = 0; j < nr; j++) {
+                sums[i][j] += static_cast<Sum>(a[i]) * b[j];
+            }
+        }
+    }
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+// the tile of sums of kc products of packed residues, kept from overflowing by folding (64-bit sums) or
+// reducing (128-bit sums) them whenever the next products could; the sums still have to be reduced
+template<size_t mr, size_t nr, typename Sum>
+void residue_products(size_t kc, const uint64_t* a, const uint64_t* b, const Modular::ResidueReduction& reduction,
+                      Sum (&sums)[mr][nr]) {
+    const size_t reduce_steps = reduction.reduce_steps();
+    for (size_t p = 0; p < kc;) {
+        size_t steps = std::min(kc - p, reduce_steps);
+        add_products(steps, a, b, sums);
+        p += steps;
+        if (p == kc) break;
+        for (size_t i = 0; i < mr; i++) {
+            for (size_t j = 0; j < nr; j++) {
+                if constexpr (std::is_same<Sum, uint64_t>::value) {
+                    sums[i][j] = (sums[i][j] >> 32) * reduction.fold_factor + (sums[i][j] & reduction.low_mask);
+                } else {
+                    sums[i][j] %= reduction.mod;
+                }
+            }
+        }
+    }
+}
+
+// residues are packed as their stored values and multiplied without reduction: the tile of sums is folded
+// only when the next products could overflow it, and reduced modulo N and brought back into the Residue
+// representation once, when it is stored
+template<size_t N>
+struct Traits<Residue<N>, void> {
+    using Packed = uint64_t;
+    static constexpr Modular::ResidueReduction reduction = Modular::ResidueReduction(N);
+    using Sum = std::conditional_t<reduction.folded, uint64_t, unsigned __int128>;
+    static constexpr size_t mr = 4;
+#if defined(__AVX512F__)
+    static constexpr size_t nr = reduction.folded ? 16 : 8;
+#else
+    static constexpr size_t nr = 8;
+#endif
+    static constexpr bool split_inner = true;
+    static constexpr size_t strassen_threshold = 256;
+
+    static Packed pack(const Residue<N>* x) {
+        return x->value;
+    }
+
+    static Packed padding() {
+        return 0;
+    }
+
+    static void micro_kernel(size_t kc, const Packed* a, const Packed* b, Residue<N>* c, size_t ldc,
+                             size_t rows, size_t cols, bool accumulate) {
+        alignas(64) Sum sums[mr][nr] = {};
+        residue_products(kc, a, b, reduction, sums);
+        for (size_t i = 0; i < rows; i++) {
+            for (size_t j = 0; j < cols; j++) {
+                size_t& value = c[i * ldc + j].value;
+                size_t sum = Residue<N>::Representation::from_product(static_cast<size_t>(sums[i][j] % N));
+                value = accumulate ? (value >= N - sum ? value - (N - sum) : value + sum) : sum;
+            }
+        }
+    }
+};
+
+// residues modulo a run-time modulus take the same kernel as Residue<N>, with the sums chosen once the
+// modulus is known
+template<>
+struct Traits<DynResidue, void> {
+    using Packed = uint64_t;
+    static constexpr size_t mr = 4;
+    static constexpr size_t nr = 8;
+    static constexpr bool split_inner = true;
+    static constexpr size_t strassen_threshold = 256;
+
+    static Packed pack(const DynResidue* x) {
+        return x->value;
+    }
+
+    static Packed padding() {
+        return 0;
+    }
+
+    template<typename Sum>
+    static void micro_kernel(size_t kc, const Packed* a, const Packed* b, DynResidue* c, size_t ldc,
+                             size_t rows, size_t cols, bool accumulate, const DynResidue::Modulus& modulus) {
+        alignas(64) Sum sums[mr][nr] = {};
+        residue_products(kc, a, b, modulus.reduction, sums);
+        for (size_t i = 0; i < rows; i++) {
+            for (size_t j = 0; j < cols; j++) {
+                uint64_t& value = c[i * ldc + j].value;
+                uint64_t sum = modulus.arithmetic.reduce(sums[i][j]);
+                value = accumulate ? modulus.arithmetic.add(value, sum) : sum;
+            }
+        }
+    }
+
+    static void micro_kernel(size_t kc, const Packed* a, const Packed* b, DynResidue* c, size_t ldc,
+                             size_t rows, size_t cols, bool accumulate) {
+        const DynResidue::Modulus& modulus = DynResidue::modulus;
+        if (modulus.reduction.folded) {
+            micro_kernel<uint64_t>(kc, a, b, c, ldc, rows, cols, accumulate, modulus);
+        } else {
+            micro_kernel<unsigned __int128>(kc, a, b, c, ldc, rows, cols, accumulate, modulus);
+        }
+    }
+};
+
+// cache blocking of an m x n by n x k product: a kc x nr sliver of packed b stays in L1 while the micro-kernel
+// runs, an mc x kc block of packed a stays in L2, and the kc x nc panel of packed b is reused for all of a.
+// The sizes come at run time, so one kernel serves every shape
+struct Tiling {
+    size_t mc;
+    size_t kc;
+    size_t nc;
+
+    static constexpr size_t round_up(size_t x, size_t r) {
+        return (x + r - 1) / r * r;
+    }
+
+    template<typename Field>
+    static constexpr Tiling of(size_t m, size_t n, size_t k) {
+        using T = Traits<Field>;
+        using Packed = typename T::Packed;
+        size_t kc = T::split_inner ? std::max<size_t>(1, std::min(n, l1_bytes / 2 / (T::nr * sizeof(Packed))))
+                                   : std::max<size_t>(1, n);
+        size_t mc = std::max(T::mr, std::min(round_up(m, T::mr), l2_bytes / 2 / (kc * sizeof(Packed)) / T::mr * T::mr));
+        size_t nc = std::max(T::nr, std::min(round_up(k, T::nr), max_panel_columns));
+        return {mc, kc, nc};
+    }
+};
+
+// copies rows x kc entries of a into panels of mr rows, each laid out column by column
+template<typename T, typename Field>
+void pack_a(typename T::Packed* to, const Field* a, size_t lda, size_t rows, size_t kc) {
+    for (size_t ir = 0; ir < rows; ir += T::mr) {
+        for (size_t p = 0; p < kc; p++) {
+            for (size_t i = 0; i < T::mr; i++) {
+                *to++ = ir + i < rows ? T::pack(a + (ir + i) * lda + p) : T::padding();
+            }
+        }
+    }
+}
+
+// copies kc x cols entries of b into panels of nr columns, each laid out row by row
+template<typename T, typename Field>
+void pack_b(typename T::Packed* to, const Field* b, size_t ldb, size_t kc, size_t cols) {
+    for (size_t jr = 0; jr < cols; jr += T::nr) {
+        for (size_t p = 0; p < kc; p++) {
+            for (size_t j = 0; j < T::nr; j++) {
+                *to++ = jr + j < cols ? T::pack(b + p * ldb + jr + j) : T::padding();
+            }
+        }
+    }
+}
+
+// the packing buffers of one Tiling, which a sequence of products can share
+template<typename Field>
+struct Workspace {
+    using Packed = typename Traits<Field>::Packed;
+
+    Tiling tiling;
+    std::vector<Packed, Row::AlignedAllocator<Packed>> packed_a;
+    std::vector<Packed, Row::AlignedAllocator<Packed>> packed_b;
+
+    explicit Workspace(Tiling tiling)
+        : tiling(tiling), packed_a(tiling.mc * tiling.kc), packed_b(tiling.kc * tiling.nc) {}
+
+    // buffers for products of up to m x n by n x k
+    Workspace(size_t m, size_t n, size_t k) : Workspace(Tiling::of<Field>(m, n, k)) {}
+};
+
+// c = a * b for row-major a (m x n with row stride lda), b (n x k, ldb) and c (m x k, ldc), where c
+// does not overlap a or b; leaves c untouched when n is zero
+template<typename Field>
+void multiply(Workspace<Field>& workspace, Field* c, size_t ldc, const Field* a, size_t lda,
+              const Field* b, size_t ldb, size_t m, size_t n, size_t k) {
+    using T = Traits<Field>;
+    const Tiling& tiling = workspace.tiling;
+    auto* packed_a = workspace.packed_a.data();
+    auto* packed_b = workspace.packed_b.data();
+    for (size_t jc = 0; jc < k; jc += tiling.nc) {
+        size_t nc = std::min(tiling.nc, k - jc);
+        for (size_t pc = 0; pc < n; pc += tiling.kc) {
+            size_t kc = std::min(tiling.kc, n - pc);
+            pack_b<T>(packed_b, b + pc * ldb + jc, ldb, kc, nc);
+            for (size_t ic = 0; ic < m; ic += tiling.mc) {
+                size_t mc = std::min(tiling.mc, m - ic);
+                pack_a<T>(packed_a, a + ic * lda + pc, lda, mc, kc);
+                for (size_t jr = 0; jr < nc; jr += T::nr) {
+                    for (size_t ir = 0; ir < mc; ir += T::mr) {
+                        T::micro_kernel(kc, packed_a + ir * kc, packed_b + jr * kc,
+                                        c + (ic + ir) * ldc + jc + jr, ldc,
+                                        std::min(T::mr, mc - ir), std::min(T::nr, nc - jr), pc > 0);
+                    }
+                }
+            }
+        }
+    }
+}
+
+template<typename Field>
+void multiply(Field* c, size_t ldc, const Field* a, size_t lda, const Field* b, size_t ldb, size_t m, size_t n, size_t k) {
+    Workspace<Field> workspace(m, n, k);
+    multiply(workspace, c, ldc, a, lda, b, ldb, m, n, k);
+}
+
+// z = x + y and z = x - y for n x n blocks
+template<typename Field>
+void add(Field* z, size_t ldz, const Field* x, size_t ldx, const Field* y, size_t ldy, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < n; j++) {
+            z[i * ldz + j] = x[i * ldx + j] + y[i * ldy + j];
+        }
+    }
+}
+
+template<typename Field>
+void subtract(Field* z, size_t ldz, const Field* x, size_t ldx, const Field* y, size_t ldy, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < n; j++) {
+            z[i * ldz + j] = x[i * ldx + j] - y[i * ldy + j];
+        }
+    }
+}
+
+// c = a * b for n x n blocks by Strassen-Winograd: 7 products of half the size, scheduled so that two
+// temporaries besides the quadrants of c suffice. An odd n peels off the last row and column, and blocks
+// of at most Traits::strassen_threshold go to the packed kernel
+template<typename Field>
+void strassen(Workspace<Field>& workspace, Field* c, size_t ldc, const Field* a, size_t lda,
+              const Field* b, size_t ldb, size_t n) {
+    if (n <= Traits<Field>::strassen_threshold) {
+        multiply(workspace, c, ldc, a, lda, b, ldb, n, n, n);
+        return;
+    }
+    if (n % 2 == 1) {
+        size_t m = n - 1;
+        strassen(workspace, c, ldc, a, lda, b, ldb, m);
+        for (size_t i = 0; i < m; i++) {
+            for (size_t j = 0; j < m; j++) {
+                c[i * ldc + j] += a[i * lda + m] * b[m * ldb + j];
+            }
+        }
+        multiply(workspace, c + m, ldc, a, lda, b + m, ldb, n, n, 1);
+        multiply(workspace, c + m * ldc, ldc, a + m * lda, lda, b, ldb, 1, n, m);
+        return;
+    }
+    size_t h = n / 2;
+    const Field* a11 = a;
+    const Field* a12 = a + h;
+    const Field* a21 = a + h * lda;
+    const Field* a22 = a21 + h;
+    const Field* b11 = b;
+    const Field* b12 = b + h;
+    const Field* b21 = b + h * ldb;
+    const Field* b22 = b21 + h;
+    Field* c11 = c;
+    Field* c12 = c + h;
+    Field* c21 = c + h * ldc;
+    Field* c22 = c21 + h;
+    std::vector<Field> x_buffer(h * h), y_buffer(h * h);
+    Field* x = x_buffer.data();
+    Field* y = y_buffer.data();
+
+    subtract(x, h, a11, lda, a21, lda, h);
+    subtract(y, h, b22, ldb, b12, ldb, h);
+    strassen(workspace, c21, ldc, x, h, y, h, h);  // (a11 - a21)(b22 - b12)
+    add(x, h, a21, lda, a22, lda, h);
+    subtract(y, h, b12, ldb, b11, ldb, h);
+    strassen(workspace, c22, ldc, x, h, y, h, h);  // (a21 + a22)(b12 - b11)
+    subtract(x, h, x, h, a11, lda, h);
+    subtract(y, h, b22, ldb, y, h, h);
+    strassen(workspace, c12, ldc, x, h, y, h, h);  // (a21 + a22 - a11)(b22 - b12 + b11)
+    subtract(x, h, a12, lda, x, h, h);
+    strassen(workspace, c11, ldc, x, h, b22, ldb, h);  // (a12 - a21 - a22 + a11) b22
+    strassen(workspace, x, h, a11, lda, b11, ldb, h);
+
+    add(c12, ldc, x, h, c12, ldc, h);
+    add(c21, ldc, c12, ldc, c21, ldc, h);
+    add(c12, ldc, c12, ldc, c22, ldc, h);
+    add(c22, ldc, c21, ldc, c22, ldc, h);
+    add(c12, ldc, c12, ldc, c11, ldc, h);
+    subtract(y, h, y, h, b21, ldb, h);
+    strassen(workspace, c11, ldc, a22, lda, y, h, h);  // a22 (b22 - b12 + b11 - b21)
+    subtract(c21, ldc, c21, ldc, c11, ldc, h);
+    strassen(workspace, c11, ldc, a12, lda, b21, ldb, h);
+    add(c11, ldc, x, h, c11, ldc, h);
+}
+
+// c = a * b for dense row-major a (m x n) and b (n x k), going through Strassen-Winograd for square
+// products above the threshold of the field
+template<typename Field>
+void product(Workspace<Field>& workspace, Field* c, const Field* a, const Field* b, size_t m, size_t n, size_t k) {
+    if (m == n && n == k && n > Traits<Field>::strassen_threshold) {
+        strassen(workspace, c, n, a, n, b, n, n);
+    } else {
+        multiply(workspace, c, k, a, n, b, k, m, n, k);
+    }
+}
+
+template<typename Field>
+void product(Field* c, const Field* a, const Field* b, size_t m, size_t n, size_t k) {
+    Workspace<Field> workspace(m, n, k);
+    product(workspace, c, a, b, m, n, k);
+}
+}
+
+// Gaussian elimination and its relatives on row-major blocks of runtime size, shared by Matrix and DynamicMatrix
+namespace Elimination {
+// elimination over Residue and Rational goes blockwise once both sides reach blocked_elimination_size: pivots are
+// found and applied within a panel of elimination_block columns, and the rest of the trailing rows is
+// updated afterwards by one product, spread over the thread pool like the row updates of every step
+static constexpr size_t elimination_block = 64;
+static constexpr size_t blocked_elimination_size = 2 * elimination_block;
+// Rational matrices from this size on get det and inverse from their images modulo many word-sized
+// primes, rebuilt by Chinese remaindering, instead of Bareiss elimination over big integers
+static constexpr size_t modular_size = 8;
+static constexpr size_t row_grain = 32;
+static constexpr size_t column_grain = 256;
+
+template<typename Field>
+void swap_rows(Field* x, size_t width, size_t i, size_t j) {
+    std::swap_ranges(x + i * width, x + (i + 1) * width, x + j * width);
+}
+
+template<typename Field>
+size_t get_first_nonzero_pos(const Field* row, size_t width) {
+    for (size_t i = 0; i < width; i++) {
+        if (row[i]) return i;
+    }
+    return width;
+}
+
+template<typename Field>
+void subtract_row(Field* a, const Field* b, const Field mul_number, size_t width) {
+    if constexpr (std::is_same<Field, BigNumber::Rational>::value) {
+        // one normalization per entry, not one for the product and another for the difference
+        const Field negated = -mul_number;
+        for (size_t i = 0; i < width; i++) {
+            fma(a[i], b[i], negated);
+        }
+    } else {
+        for (size_t i = 0; i < width; i++) {
+            a[i] -= b[i] * mul_number;
+        }
+    }
+}
+
+template<typename Field>
+void div_row(Field* a, const Field div_number, size_t width) {
+    for (size_t i = 0; i < width; i++) {
+        a[i] /= div_number;
+    }
+}
+
+// transform for big matrices, with the same pivots and the same result. While a panel is eliminated, the
+// entries of its pivot columns below the pivots keep their multipliers
+template<typename Field>
+Field transform_blocked(Field* x, size_t m, size_t n) {
+    size_t swaps = 0;
+    Field det = 1;
+    size_t r = 0;
+    for (size_t c = 0; c < n && r < m; c += elimination_block) {
+        size_t end = std::min(n, c + elimination_block);
+        size_t first = r;
+        std::vector<size_t> columns;
+        std::vector<Field> inverses;
+        for (size_t p = c; p < end && r < m; p++) {
+            size_t j = r;
+            while (j < m && !x[j * n + p]) j++;
+            if (j == m) continue;
+            if (j != r) {
+                swap_rows(x, n, j, r);
+                swaps++;
+            }
+            if (m == n) det *= p == r ? x[r * n + p] : Field(0);
+            Field inverse = Field(1) / x[r * n + p];
+            Field* pivot_row = x + r * n;
+            pivot_row[p] = 1;
+            for (size_t q = p + 1; q < end; q++) pivot_row[q] *= inverse;
+            parallel_for_entries<Field>(r + 1, m, row_grain, [&](size_t from, size_t to) {
+                for (size_t i = from; i < to; i++) {
+                    Field* row = x + i * n;
+                    if (!row[p]) continue;
+                    for (size_t q = p + 1; q < end; q++) row[q] -= row[p] * pivot_row[q];
+                }
+            });
+            columns.push_back(p);
+            inverses.push_back(inverse);
+            r++;
+        }
+        size_t k = columns.size();
+        if (k == 0) continue;
+        size_t rest = n - end;
+        // the pivot rows take the updates of the pivots above them, then their own normalization
+        parallel_for_entries<Field>(end, n, column_grain, [&](size_t from, size_t to) {
+            for (size_t t = 0; t < k; t++) {
+                Field* row = x + (first + t) * n;
+                for (size_t u = 0; u < t; u++) {
+                    const Field& multiplier = row[columns[u]];
+                    if (!multiplier) continue;
+                    const Field* pivot_row = x + (first + u) * n;
+                    for (size_t q = from; q < to; q++) row[q] -= multiplier * pivot_row[q];
+                }
+                for (size_t q = from; q < to; q++) row[q] *= inverses[t];
+            }
+        });
+        // the trailing rows take all of them at once
+        if (r < m && rest > 0) {
+            std::vector<Field> multipliers((m - r) * k);
+            for (size_t i = r; i < m; i++) {
+                for (size_t t = 0; t < k; t++) multipliers[(i - r) * k + t] = x[i * n + columns[t]];
+            }
+            parallel_for_entries<Field>(r, m, row_grain, [&](size_t from, size_t to) {
+                std::vector<Field> product((to - from) * rest);
+                Kernel::multiply(
+                        product.data(), rest, multipliers.data() + (from - r) * k, k, x + first * n + end, n, to - from, k, rest);
+                for (size_t i = from; i < to; i++) {
+                    for (size_t q = 0; q < rest; q++) x[i * n + end + q] -= product[(i - from) * rest + q];
+                }
+            });
+        }
+        for (size_t i = first; i < m; i++) {
+            for (size_t t = 0; t < k && first + t < i; t++) x[i * n + columns[t]] = 0;
+        }
+    }
+    if (m == n && r < m) det = 0;
+    if (swaps & 1) det *= -1;
+    return det;
+}
+
+// brings the m x n block x to row echelon form with unit pivots, returning its determinant when it is square
+template<typename Field>
+Field transform(Field* x, size_t m, size_t n) {
+    if constexpr (!std::is_arithmetic<Field>::value) {
+        if (m >= blocked_elimination_size && n >= blocked_elimination_size) return transform_blocked(x, m, n);
+    }
+    size_t cnt_swaps = 0;
+    Field det = 1;
+    for (size_t i = 0; i < m; i++) {
+        size_t pos = get_first_nonzero_pos(x + i * n, n);
+        size_t best_i = i;
+        for (size_t j = i + 1; j < m; j++) {
+            size_t pos_j = get_first_nonzero_pos(x + j * n, n);
+            if (pos_j < pos) {
+                pos = pos_j;
+                best_i = j;
+            }
+        }
+        if (i != best_i) {
+            swap_rows(x, n, i, best_i);
+            cnt_swaps++;
+        }
+        if (m == n) det *= x[i * n + i];
+        if (pos >= n) break;
+        div_row(x + i * n, x[i * n + pos], n);
+        parallel_for_entries<Field>(i + 1, m, row_grain, [&](size_t first, size_t last) {
+            for (size_t j = first; j < last; j++) {
+                subtract_row(x + j * n, x + i * n, x[j * n + pos], n);
+            }
+        });
+    }
+    if (cnt_swaps & 1) det *= -1;
+    return det;
+}
+
+// clears the unit upper triangular left half of the n x 2n block [U | X] bottom up, elimination_block pivots
+// at a time: within the block row by row, and for the rows above it with one product
+template<typename Field>
+void back_substitute_blocked(Field* x, size_t n) {
+    const size_t width = 2 * n;
+    for (size_t end = n; end > 0;) {
+        size_t begin = end > elimination_block ? end - elimination_block : 0;
+        parallel_for_entries<Field>(n, width, column_grain, [&](size_t from, size_t to) {
+            for (size_t i = end; i-- > begin;) {
+                const Field* pivot_row = x + i * width;
+                for (size_t j = begin; j < i; j++) {
+                    Field* row = x + j * width;
+                    if (!row[i]) continue;
+                    for (size_t q = from; q < to; q++) row[q] -= row[i] * pivot_row[q];
+                }
+            }
+        });
+        size_t k = end - begin;
+        parallel_for_entries<Field>(0, begin, row_grain, [&](size_t from, size_t to) {
+            std::vector<Field> product((to - from) * n);
+            Kernel::multiply(
+                    product.data(), n, x + from * width + begin, width, x + begin * width + n, width, to - from, k, n);
+            for (size_t i = from; i < to; i++) {
+                for (size_t q = 0; q < n; q++) x[i * width + n + q] -= product[(i - from) * n + q];
+            }
+        });
+        for (size_t i = 0; i < end; i++) {
+            for (size_t j = std::max(begin, i + 1); j < end; j++) x[i * width + j] = 0;
+        }
+        end = begin;
+    }
+}
+
+using IntegerRows = Modular::IntegerRows;
+
+// the rows of an m x n Rational block multiplied by the lcm of their denominators, which go to scale
+inline IntegerRows scaled_to_integers(const BigNumber::Rational* x, size_t m, size_t n, std::vector<BigNumber::BigInteger>& scale) {
+    IntegerRows result(m, std::vector<BigNumber::BigInteger>(n));
+    scale.assign(m, 1);
+    for (size_t i = 0; i < m; i++) {
+        const BigNumber::Rational* row = x + i * n;
+        for (size_t j = 0; j < n; j++) {
+            const BigNumber::BigInteger& d = row[j].get_denominator();
+            if (!d.is_one()) scale[i] = scale[i] / gcd(scale[i], d) * d;
+        }
+        for (size_t j = 0; j < n; j++) {
+            const BigNumber::BigInteger& d = row[j].get_denominator();
+            result[i][j] = row[j].get_numerator();
+            if (!scale[i].is_one()) result[i][j] *= d.is_one() ? scale[i] : scale[i] / d;
+            if (row[j].get_sign() == BigNumber::Sign::minus) result[i][j] = -result[i][j];
+        }
+    }
+    return result;
+}
+
+// rows per task in a parallel Bareiss step that updates this many entries of each row
+inline size_t bareiss_grain(size_t width) {
+    return std::max<size_t>(1, 256 / std::max<size_t>(width, 1));
+}
+
+// (pivot * x - factor * y) / prev, exact for every entry Bareiss elimination produces
+inline BigNumber::BigInteger bareiss_update(const BigNumber::BigInteger& pivot, const BigNumber::BigInteger& x,
+                                            const BigNumber::BigInteger& factor, const BigNumber::BigInteger& y,
+                                            const BigNumber::BigInteger& prev) {
+    BigNumber::ProductSum<BigNumber::BigInteger> sum;
+    sum.add(pivot, x);
+    sum.add(factor, y, BigNumber::Sign::minus);
+    BigNumber::BigInteger result = sum.value();
+    if (prev != 1) result /= prev;
+    return result;
+}
+
+// fraction-free (Bareiss) elimination of the first columns of x to row echelon form; every division is
+// exact, so the entries are minors of x and stay within Hadamard's bound instead of growing with each step.
+// Returns the rank, the last pivot is the determinant when x is square and nonsingular, up to the sign
+// that negate tracks for the row swaps
+inline size_t bareiss_eliminate(IntegerRows& x, size_t columns, bool& negate) {
+    BigNumber::BigInteger prev = 1;
+    size_t rank = 0;
+    for (size_t c = 0; c < columns && rank < x.size(); c++) {
+        size_t p = rank;
+        while (p < x.size() && !x[p][c]) p++;
+        if (p == x.size()) continue;
+        if (p != rank) {
+            std::swap(x[p], x[rank]);
+            negate = !negate;
+        }
+        Parallel::parallel_for(rank + 1, x.size(), bareiss_grain(x[rank].size() - c), [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; i++) {
+                for (size_t j = c + 1; j < x[i].size(); j++) {
+                    x[i][j] = bareiss_update(x[rank][c], x[i][j], x[i][c], x[rank][j], prev);
+                }
+                x[i][c] = 0;
+            }
+        });
+        prev = x[rank][c];
+        rank++;
+    }
+    return rank;
+}
+
+// fraction-free Gauss-Jordan on [x | I] for a nonsingular square x: eliminates above and below each pivot
+// and leaves det(x) * x^(-1) in the right half, returning det(x)
+inline BigNumber::BigInteger bareiss_invert(IntegerRows& x) {
+    size_t n = x.size();
+    for (size_t i = 0; i < n; i++) {
+        x[i].resize(2 * n, 0);
+        x[i][n + i] = 1;
+    }
+    BigNumber::BigInteger prev = 1;
+    for (size_t k = 0; k < n; k++) {
+        size_t p = k;
+        while (p < n && !x[p][k]) p++;
+        if (p == n) break;
+        std::swap(x[p], x[k]);
+        Parallel::parallel_for(0, n, bareiss_grain(2 * n - k), [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; i++) {
+                if (i == k) continue;
+                for (size_t j = k + 1; j < 2 * n; j++) {
+                    x[i][j] = bareiss_update(x[k][k], x[i][j], x[i][k], x[k][j], prev);
+                }
+                x[i][k] = 0;
+            }
+        });
+        prev = x[k][k];
+    }
+    return prev;
+}
+
+// the determinant of the n x n block x
+template<typename Field>
+Field det(const Field* x, size_t n) {
+    if constexpr (std::is_same<Field, BigNumber::Rational>::value) {
+        std::vector<BigNumber::BigInteger> scale;
+        IntegerRows y = scaled_to_integers(x, n, n, scale);
+        BigNumber::BigInteger total_scale = 1;
+        for (size_t i = 0; i < n; i++) total_scale *= scale[i];
+        if (n >= modular_size) {
+            Field det = Modular::determinant(y);
+            if (!total_scale.is_one()) det /= total_scale;
+            return det;
+        }
+        bool negate = false;
+        if (bareiss_eliminate(y, n, negate) < n) return 0;
+        Field det = n ? Field(y[n - 1][n - 1]) : Field(1);
+        if (!total_scale.is_one()) det /= total_scale;
+        if (negate) det = -det;
+        return det;
+    } else {
+        std::vector<Field> copy(x, x + n * n);
+        return transform(copy.data(), n, n);
+    }
+}
+
+// the rank of the m x n block x
+template<typename Field>
+size_t rank(const Field* x, size_t m, size_t n) {
+    if constexpr (std::is_same<Field, BigNumber::Rational>::value) {
+        std::vector<BigNumber::BigInteger> scale;
+        IntegerRows y = scaled_to_integers(x, m, n, scale);
+        bool negate = false;
+        return bareiss_eliminate(y, n, negate);
+    } else {
+        std::vector<Field> copy(x, x + m * n);
+        transform(copy.data(), m, n);
+        size_t rank = 0;
+        for (size_t i = 0; i < m && get_first_nonzero_pos(copy.data() + i * n, n) < n; i++, rank++) {}
+        return rank;
+    }
+}
+
+// replaces the nonsingular n x n block x by its inverse
+template<typename Field>
+void invert(Field* x, size_t n) {
+    if constexpr (std::is_same<Field, BigNumber::Rational>::value) {
+        std::vector<BigNumber::BigInteger> scale;
+        IntegerRows y = scaled_to_integers(x, n, n, scale);
+        if (n >= modular_size) {
+            IntegerRows adjugate;
+            Field det = Modular::adjugate(y, adjugate);
+            if (det) {
+                for (size_t i = 0; i < n; i++) {
+                    for (size_t j = 0; j < n; j++) {
+                        x[i * n + j] = scale[j].is_one() ? adjugate[i][j] : adjugate[i][j] * scale[j];
+                        x[i * n + j] /= det;
+                    }
+                }
+                return;
+            }
+        }
+        Field det = bareiss_invert(y);
+        for (size_t i = 0; i < n; i++) {
+            for (size_t j = 0; j < n; j++) {
+                x[i * n + j] = scale[j].is_one() ? y[i][n + j] : y[i][n + j] * scale[j];
+                x[i * n + j] /= det;
+            }
+        }
+    } else {
+        const size_t width = 2 * n;
+        std::vector<Field> copy(n * width, Field(0));
+        for (size_t i = 0; i < n; i++) {
+            std::copy(x + i * n, x + (i + 1) * n, copy.begin() + i * width);
+            copy[i * width + n + i] = 1;
+        }
+        Field* y = copy.data();
+        transform(y, n, width);
+        if (!std::is_arithmetic<Field>::value && n >= blocked_elimination_size) {
+            back_substitute_blocked(y, n);
+        } else {
+            for (size_t i = 0; i < n; i++) {
+                parallel_for_entries<Field>(0, n - 1 - i, row_grain, [&](size_t first, size_t last) {
+                    for (size_t j = first; j < last; j++) {
+                        subtract_row(y + j * width, y + (n - 1 - i) * width, y[j * width + n - 1 - i], width);
+                    }
+                });
+            }
+        }
+        for (size_t i = 0; i < n; i++) {
+            std::copy(y + i * width + n, y + (i + 1) * width, x + i * n);
+        }
+    }
+}
+}
+
+template<size_t M, size_t N, typename Field = BigNumber::Rational> 
+class Matrix {
+private:
+    Row::Storage<M, N, Field> a = allocate();
+
+private:
+    static Row::Storage<M, N, Field> allocate() {
+        if constexpr (std::is_same<Row::Storage<M, N, Field>, std::array<Field, M * N>>::value) {
+            return Row::Storage<M, N, Field>();
+        } else {
+            return Row::Storage<M, N, Field>(M * N);
+        }
+    }
+
+    struct zero_tag {};
+
+    explicit Matrix(zero_tag) {}
+
+public:
+    Matrix() {
+        if (M == N) {
+            for (size_t i = 0; i < M; i++) {
+                (*this)[i][i] = 1;
+            }
+        }
+    }
+
+    Matrix(const std::initializer_list<std::initializer_list<int>> x) {
+        size_t cur = 0;
+        for (auto i = x.begin(); i != x.end(); i++) {
+            for (auto j = i->begin(); j != i->end(); j++, cur++) {
+                (*this)[cur / N][cur % N] = *j;
+            }
+        }
+    }
+
+    Matrix(const Matrix<M, N, Field>& x) : a(x.a) {}
+
+    Matrix(Matrix<M, N, Field>&& x) = default;
+
+    Matrix<M, N, Field>& operator=(const Matrix<M, N, Field>& x) = default;
+
+    Matrix<M, N, Field>& operator=(Matrix<M, N, Field>&& x) = default;
 
     template<typename T>
     Matrix(const std::vector<std::vector<T>>& x) {
         for (size_t i = 0; i < M; i++) {
             for (size_t j = 0; j < N; j++) {
-                a[i][j] = x[i][j];
+                (*this)[i][j] = x[i][j];
             }
         }
     }
 
+    static Matrix<M, N, Field> zero() {
+        return Matrix<M, N, Field>(zero_tag());
+    }
+
     void set_zero() {
-        for (size_t i = 0; i < M; i++) {
-            for (size_t j = 0; j < N; j++) {
-                a[i][j] = 0;
-            }
-        }
+        std::fill(a.begin(), a.end(), Field(0));
     }
 
-    Row::Row<N, Field>& operator[](size_t i) {
-        return a[i];
+    Field* data() {
+        return a.data();
     }
 
-    const Row::Row<N, Field>& operator[](size_t i) const {
-        return a[i];
+    const Field* data() const {
+        return a.data();
     }
 
-    std::vector<Field> getRow(size_t i) const{
-        return a[i].getRow();
+    Row::Row<N, Field> operator[](size_t i) {
+        return Row::Row<N, Field>(a.data() + i * N);
     }
 
-    std::vector<Field> getColumn(size_t j) const {
-        std::vector<Field> result(M);
-        for (size_t i = 0; i < M; i++) {
-            result[i] = a[i][j];
-        }
-        return result;
+    Row::Row<N, const Field> operator[](size_t i) const {
+        return Row::Row<N, const Field>(a.data() + i * N);
+    }
+
+    Row::Row<N, Field> getRow(size_t i) {
+        return (*this)[i];
+    }
+
+    Row::Row<N, const Field> getRow(size_t i) const {
+        return (*this)[i];
+    }
+
+    Row::Column<M, Field> getColumn(size_t j) {
+        return Row::Column<M, Field>(a.data() + j, N);
+    }
+
+    Row::Column<M, const Field> getColumn(size_t j) const {
+        return Row::Column<M, const Field>(a.data() + j, N);
     }
 
     Matrix<M, N, Field>& operator+=(const Matrix<M, N, Field>& rhs) {
         for (size_t i = 0; i < M; i++) {
             for (size_t j = 0; j < N; j++) {
-                a[i][j] += rhs[i][j];
+                (*this)[i][j] += rhs[i][j];
             }
         }
         return *this;
@@ -928,7 +1908,7 @@ public:
     Matrix<M, N, Field>& operator-=(const Matrix<M, N, Field>& rhs) {
         for (size_t i = 0; i < M; i++) {
             for (size_t j = 0; j < N; j++) {
-                a[i][j] -= rhs[i][j];
+                (*this)[i][j] -= rhs[i][j];
             }
         }
         return *this;
@@ -936,16 +1916,9 @@ public:
 
     Matrix<M, M, Field>& operator*=(const Matrix<M, M, Field>& rhs) {
         static_assert(M == N);
-        Matrix<M, M, Field> result;
-        result.set_zero();
-        for (size_t i = 0; i < M; i++) {
-            for (size_t j = 0; j < M; j++) {
-                for (size_t t = 0; t < M; t++) {
-                    result[i][t] += a[i][j] * rhs[j][t];
-                }
-            }
-        }
-        std::swap(a, result.a);
+        Matrix<M, M, Field> result = zero();
+        Kernel::product(result.data(), data(), rhs.data(), M, M, M);
+        a = std::move(result.a);
         return *this;
     }
 
@@ -954,87 +1927,37 @@ public:
         result.set_zero();
         for (size_t i = 0; i < N; i++) {
             for (size_t j = 0; j < M; j++) {
-                result[i][j] = a[j][i];
+                result[i][j] = (*this)[j][i];
             }
         }
-        return result;
-    }
-
-    Field transform_to_triangular_matrix() {
-        size_t cnt_swaps = 0;
-        Field det = 1;
-        for (size_t i = 0; i < M; i++) {
-            size_t pos = get_first_nonzero_pos(a[i]);
-            size_t best_i = i;
-            for (size_t j = i + 1; j < M; j++) {
-                size_t pos_j = get_first_nonzero_pos(a[j]);
-                if (pos_j < pos) {
-                    pos = pos_j;
-                    best_i = j;
-                }
-            }
-            if (i != best_i) {
-                std::swap(a[i], a[best_i]);
-                cnt_swaps++;
-            }
-            if (M == N) det *= a[i][i];
-            if (pos >= N) break; 
-            div_row(a[i], a[i][pos]);
-            for (size_t j = i + 1; j < M; j++) {
-                subtract_row(a[j], a[i], a[j][pos]);
-            }
-        }
-        if (cnt_swaps & 1) det *= -1;
-        return det;
+        return result;
+    }
+
+    Field transform_to_triangular_matrix() {
+        return Elimination::transform(data(), M, N);
     }
 
     Field det() const {
         static_assert(M == N);
-        Matrix<M, N, Field> copy = *this;
-        Field det = copy.transform_to_triangular_matrix();
-        return det;
+        return Elimination::det(data(), N);
     }
 
     size_t rank() const {
-        Matrix<M, N, Field> copy = *this;
-        copy.transform_to_triangular_matrix();
-        size_t rank = 0;
-        for (size_t i = 0; i < M && !is_zero(copy[i]); i++, rank++) {}
-        return rank;
+        return Elimination::rank(data(), M, N);
     }
 
     Field trace() const {
         static_assert(M == N);
         Field result = 0;
         for (size_t i = 0; i < M; i++) {
-            result += a[i][i];
+            result += (*this)[i][i];
         }
         return result;
     }
     
     void invert() {
         static_assert(M == N);
-        Matrix<M, 2 * N, Field> copy;
-        copy.set_zero();
-        for (size_t i = 0; i < M; i++) {
-            for (size_t j = 0; j < N; j++) {
-                copy[i][j] = a[i][j];
-            }
-        }
-        for (size_t i = 0; i < M; i++) {
-            copy[i][N + i] = 1; 
-        }
-        copy.transform_to_triangular_matrix();
-        for (size_t i = 0; i < M; i++) {
-            for (size_t j = 0; j < M - 1 - i; j++) {
-                subtract_row(copy[j], copy[M - 1 - i], copy[j][M - 1 - i]);
-            }
-        }
-        for (size_t i = 0; i < M; i++) {
-            for (size_t j = 0; j < N; j++) {
-                a[i][j] = copy[i][N + j];
-            }
-        }
+        Elimination::invert(data(), N);
     }
 
     Matrix<M, N, Field> inverted() const {
@@ -1061,15 +1984,8 @@ Matrix<M, N, Field> operator-(const Matrix<M, N, Field>& lhs, const Matrix<M, N,
 
 template<size_t M, size_t N, size_t K, typename Field = BigNumber::Rational>
 Matrix<M, K, Field> operator*(const Matrix<M, N, Field>& lhs, const Matrix<N, K, Field>& rhs) {
-    Matrix<M, K, Field> result;
-    result.set_zero();
-    for (size_t i = 0; i < M; i++) {
-        for (size_t j = 0; j < N; j++) {
-            for (size_t t = 0; t < K; t++) {
-                result[i][t] += lhs[i][j] * rhs[j][t];
-            }
-        }
-    }
+    Matrix<M, K, Field> result = Matrix<M, K, Field>::zero();
+    Kernel::product(result.data(), lhs.data(), rhs.data(), M, N, K);
     return result;
 }
 
@@ -1121,4 +2037,639 @@ std::istream& operator>>(std::istream& in, Matrix<M, N, Field>& a) {
 }
 
 template<size_t N, typename Field = BigNumber::Rational>
-using SquareMatrix = Matrix<N, N, Field>;
\ No newline at end of file
+using SquareMatrix = Matrix<N, N, Field>;
+
+// a matrix whose size is only known at run time. It keeps its entries like a big Matrix, in one aligned
+// row-major block, and goes through the same Kernel and Elimination code, so that shapes read from input
+// need no instantiation of their own. Operands of +, - and * of mismatched sizes throw std::invalid_argument
+template<typename Field = BigNumber::Rational>
+class DynamicMatrix {
+private:
+    size_t m;
+    size_t n;
+    std::vector<Field, Row::AlignedAllocator<Field>> a;
+
+    // the run-time counterpart of the matching M and N that Matrix requires of the operands of +, - and *
+    void require_same_shape(const DynamicMatrix<Field>& rhs, const char* operation) const {
+        if (m != rhs.m || n != rhs.n) throw std::invalid_argument(std::string(operation) + " needs matrices of the same size");
+    }
+
+public:
+    // the run-time counterpart of the static_assert(M == N) of Matrix
+    void require_square(const char* operation) const {
+        if (m != n) throw std::invalid_argument(std::string(operation) + " needs a square matrix");
+    }
+
+    // the identity when square, otherwise zero, like Matrix
+    DynamicMatrix(size_t m, size_t n) : m(m), n(n), a(m * n, Field(0)) {
+        if (m == n) {
+            for (size_t i = 0; i < m; i++) {
+                (*this)[i][i] = 1;
+            }
+        }
+    }
+
+    explicit DynamicMatrix(size_t n) : DynamicMatrix(n, n) {}
+
+    DynamicMatrix(const std::initializer_list<std::initializer_list<int>> x)
+        : m(x.size()), n(x.size() ? x.begin()->size() : 0), a(m * n, Field(0)) {
+        size_t cur = 0;
+        for (auto i = x.begin(); i != x.end(); i++) {
+            for (auto j = i->begin(); j != i->end(); j++, cur++) {
+                a[cur] = *j;
+            }
+        }
+    }
+
+    template<typename T>
+    DynamicMatrix(const std::vector<std::vector<T>>& x)
+        : m(x.size()), n(x.empty() ? 0 : x[0].size()), a(m * n) {
+        for (size_t i = 0; i < m; i++) {
+            for (size_t j = 0; j < n; j++) {
+                (*this)[i][j] = x[i][j];
+            }
+        }
+    }
+
+    template<size_t M, size_t N>
+    DynamicMatrix(const Matrix<M, N, Field>& x) : m(M), n(N), a(x.data(), x.data() + M * N) {}
+
+    DynamicMatrix(const DynamicMatrix<Field>& x) = default;
+
+    DynamicMatrix(DynamicMatrix<Field>&& x) = default;
+
+    DynamicMatrix<Field>& operator=(const DynamicMatrix<Field>& x) = default;
+
+    DynamicMatrix<Field>& operator=(DynamicMatrix<Field>&& x) = default;
+
+    static DynamicMatrix<Field> zero(size_t m, size_t n) {
+        DynamicMatrix<Field> result(m, n);
+        result.set_zero();
+        return result;
+    }
+
+    size_t rows() const {
+        return m;
+    }
+
+    size_t columns() const {
+        return n;
+    }
+
+    void set_zero() {
+        std::fill(a.begin(), a.end(), Field(0));
+    }
+
+    Field* data() {
+        return a.data();
+    }
+
+    const Field* data() const {
+        return a.data();
+    }
+
+    Field* operator[](size_t i) {
+        return a.data() + i * n;
+    }
+
+    const Field* operator[](size_t i) const {
+        return a.data() + i * n;
+    }
+
+    std::vector<Field> getRow(size_t i) const {
+        return std::vector<Field>((*this)[i], (*this)[i] + n);
+    }
+
+    std::vector<Field> getColumn(size_t j) const {
+        std::vector<Field> result(m);
+        for (size_t i = 0; i < m; i++) {
+            result[i] = (*this)[i][j];
+        }
+        return result;
+    }
+
+    DynamicMatrix<Field>& operator+=(const DynamicMatrix<Field>& rhs) {
+        require_same_shape(rhs, "+=");
+        for (size_t i = 0; i < m * n; i++) {
+            a[i] += rhs.a[i];
+        }
+        return *this;
+    }
+
+    DynamicMatrix<Field>& operator-=(const DynamicMatrix<Field>& rhs) {
+        require_same_shape(rhs, "-=");
+        for (size_t i = 0; i < m * n; i++) {
+            a[i] -= rhs.a[i];
+        }
+        return *this;
+    }
+
+    DynamicMatrix<Field>& operator*=(const DynamicMatrix<Field>& rhs) {
+        *this = *this * rhs;
+        return *this;
+    }
+
+    DynamicMatrix<Field> transposed() const {
+        DynamicMatrix<Field> result = zero(n, m);
+        for (size_t i = 0; i < n; i++) {
+            for (size_t j = 0; j < m; j++) {
+                result[i][j] = (*this)[j][i];
+            }
+        }
+        return result;
+    }
+
+    Field transform_to_triangular_matrix() {
+        return Elimination::transform(data(), m, n);
+    }
+
+    Field det() const {
+        require_square("det");
+        return Elimination::det(data(), n);
+    }
+
+    size_t rank() const {
+        return Elimination::rank(data(), m, n);
+    }
+
+    Field trace() const {
+        require_square("trace");
+        Field result = 0;
+        for (size_t i = 0; i < m; i++) {
+            result += (*this)[i][i];
+        }
+        return result;
+    }
+
+    void invert() {
+        require_square("invert");
+        Elimination::invert(data(), n);
+    }
+
+    DynamicMatrix<Field> inverted() const {
+        DynamicMatrix<Field> copy = *this;
+        copy.invert();
+        return copy;
+    }
+};
+
+template<typename Field>
+DynamicMatrix<Field> operator+(const DynamicMatrix<Field>& lhs, const DynamicMatrix<Field>& rhs) {
+    DynamicMatrix<Field> copy = lhs;
+    copy += rhs;
+    return copy;
+}
+
+template<typename Field>
+DynamicMatrix<Field> operator-(const DynamicMatrix<Field>& lhs, const DynamicMatrix<Field>& rhs) {
+    DynamicMatrix<Field> copy = lhs;
+    copy -= rhs;
+    return copy;
+}
+
+template<typename Field>
+DynamicMatrix<Field> operator*(const DynamicMatrix<Field>& lhs, const DynamicMatrix<Field>& rhs) {
+    if (lhs.columns() != rhs.rows()) throw std::invalid_argument("* needs as many columns on the left as rows on the right");
+    DynamicMatrix<Field> result = DynamicMatrix<Field>::zero(lhs.rows(), rhs.columns());
+    Kernel::product(result.data(), lhs.data(), rhs.data(), lhs.rows(), lhs.columns(), rhs.columns());
+    return result;
+}
+
+template<typename Field>
+DynamicMatrix<Field> operator*(const DynamicMatrix<Field>& lhs, const Field& number) {
+    DynamicMatrix<Field> result = lhs;
+    for (size_t i = 0; i < lhs.rows(); i++) {
+        for (size_t j = 0; j < lhs.columns(); j++) {
+            result[i][j] *= number;
+        }
+    }
+    return result;
+}
+
+template<typename Field>
+bool operator==(const DynamicMatrix<Field>& lhs, const DynamicMatrix<Field>& rhs) {
+    if (lhs.rows() != rhs.rows() || lhs.columns() != rhs.columns()) return false;
+    return std::equal(lhs.data(), lhs.data() + lhs.rows() * lhs.columns(), rhs.data());
+}
+
+template<typename Field>
+bool operator!=(const DynamicMatrix<Field>& lhs, const DynamicMatrix<Field>& rhs) {
+    return !(lhs == rhs);
+}
+
+template<typename Field>
+std::ostream& operator<<(std::ostream& out, const DynamicMatrix<Field>& a) {
+    for (size_t i = 0; i < a.rows(); i++) {
+        for (size_t j = 0; j < a.columns(); j++) {
+            out << a[i][j] << ' ';
+        }
+        out << '\n';
+    }
+    return out;
+}
+
+template<typename Field>
+std::istream& operator>>(std::istream& in, DynamicMatrix<Field>& a) {
+    for (size_t i = 0; i < a.rows(); i++) {
+        for (size_t j = 0; j < a.columns(); j++) {
+            in >> a[i][j];
+        }
+    }
+    return in;
+}
+
+namespace Power {
+// the bits of |x|, least significant first, read off its 64-bit limbs
+inline std::vector<bool> bits(const BigNumber::BigInteger& x) {
+    std::vector<bool> result;
+    for (size_t i = 0; i < x.size(); i++) {
+        for (size_t j = 0; j < 64; j++) result.push_back((x[i] >> j) & 1);
+    }
+    while (!result.empty() && !result.back()) result.pop_back();
+    return result;
+}
+
+inline std::vector<bool> bits(unsigned long long x) {
+    std::vector<bool> result;
+    for (; x; x >>= 1) result.push_back(x & 1);
+    return result;
+}
+
+// the width of the sliding window that needs the fewest products for an exponent of this many bits,
+// counting the 2^(width - 1) - 1 products that build the table of odd powers
+inline size_t window_width(size_t bit_count) {
+    size_t best = 1;
+    for (size_t width = 2; width <= 6; width++) {
+        size_t products = ((size_t(1) << (width - 1)) - 1) + bit_count / (width + 1);
+        size_t best_products = ((size_t(1) << (best - 1)) - 1) + bit_count / (best + 1);
+        if (products < best_products) best = width;
+    }
+    return best;
+}
+
+// x^e for an n x n matrix x of Square, Matrix or DynamicMatrix, and the exponent given by its bits, by
+// left-to-right sliding window exponentiation. Every product is written into the other one of two buffers,
+// and they all share one kernel workspace
+template<typename Field, typename Square>
+Square power(const Square& x, size_t n, const std::vector<bool>& e, const Square& identity) {
+    if (e.empty()) return identity;
+    Kernel::Workspace<Field> workspace(n, n, n);
+    auto multiply = [&workspace, n](Field* c, const Field* a, const Field* b) {
+        Kernel::product(workspace, c, a, b, n, n, n);
+    };
+
+    size_t width = window_width(e.size());
+    // odd_powers[i] = x^(2i + 1)
+    std::vector<Square> odd_powers;
+    odd_powers.reserve(size_t(1) << (width - 1));
+    odd_powers.push_back(x);
+    if (width > 1) {
+        Square square = x;
+        multiply(square.data(), x.data(), x.data());
+        for (size_t i = 1; i < (size_t(1) << (width - 1)); i++) {
+            odd_powers.push_back(x);
+            multiply(odd_powers[i].data(), odd_powers[i - 1].data(), square.data());
+        }
+    }
+
+    // both are overwritten by the first product they receive
+    Square buffers[2] = {x, x};
+    size_t current = 0;
+    bool started = false;
+    for (size_t i = e.size(); i-- > 0;) {
+        if (!e[i]) {
+            multiply(buffers[current ^ 1].data(), buffers[current].data(), buffers[current].data());
+            current ^= 1;
+            continue;
+        }
+        // the longest window of at most width bits ending in a one
+        size_t low = i + 1 >= width ? i + 1 - width : 0;
+        while (!e[low]) low++;
+        size_t window = 0;
+        for (size_t j = i + 1; j-- > low;) window = window * 2 + e[j];
+        if (!started) {
+            buffers[current] = odd_powers[window / 2];
+            started = true;
+        } else {
+            for (size_t j = low; j <= i; j++) {
+                multiply(buffers[current ^ 1].data(), buffers[current].data(), buffers[current].data());
+                current ^= 1;
+            }
+            multiply(buffers[current ^ 1].data(), buffers[current].data(), odd_powers[window / 2].data());
+            current ^= 1;
+        }
+        i = low;
+    }
+    return std::move(buffers[current]);
+}
+}
+
+// x^exponent; a negative exponent raises the inverse of x, which must then be invertible
+template<size_t N, typename Field>
+SquareMatrix<N, Field> pow(const SquareMatrix<N, Field>& x, const BigNumber::BigInteger& exponent) {
+    if (exponent.get_sign() == BigNumber::Sign::minus) return pow(x.inverted(), -exponent);
+    return Power::power<Field>(x, N, Power::bits(exponent), SquareMatrix<N, Field>());
+}
+
+template<size_t N, typename Field, typename Integer, typename = std::enable_if_t<std::is_integral<Integer>::value>>
+SquareMatrix<N, Field> pow(const SquareMatrix<N, Field>& x, Integer exponent) {
+    if constexpr (std::is_signed<Integer>::value) {
+        if (exponent < 0) {
+            unsigned long long magnitude = 0ull - static_cast<unsigned long long>(exponent);
+            return Power::power<Field>(x.inverted(), N, Power::bits(magnitude), SquareMatrix<N, Field>());
+        }
+    }
+    return Power::power<Field>(x, N, Power::bits(static_cast<unsigned long long>(exponent)), SquareMatrix<N, Field>());
+}
+
+template<typename Field>
+DynamicMatrix<Field> pow(const DynamicMatrix<Field>& x, const BigNumber::BigInteger& exponent) {
+    x.require_square("pow");
+    if (exponent.get_sign() == BigNumber::Sign::minus) return pow(x.inverted(), -exponent);
+    return Power::power<Field>(x, x.rows(), Power::bits(exponent), DynamicMatrix<Field>(x.rows()));
+}
+
+template<typename Field, typename Integer, typename = std::enable_if_t<std::is_integral<Integer>::value>>
+DynamicMatrix<Field> pow(const DynamicMatrix<Field>& x, Integer exponent) {
+    x.require_square("pow");
+    if constexpr (std::is_signed<Integer>::value) {
+        if (exponent < 0) {
+            unsigned long long magnitude = 0ull - static_cast<unsigned long long>(exponent);
+            return Power::power<Field>(x.inverted(), x.rows(), Power::bits(magnitude), DynamicMatrix<Field>(x.rows()));
+        }
+    }
+    return Power::power<Field>(x, x.rows(), Power::bits(static_cast<unsigned long long>(exponent)), DynamicMatrix<Field>(x.rows()));
+}
+
+// a sparse matrix in compressed sparse row form: the nonzero entries of row i are value[k] in the columns
+// column[k] for row_start[i] <= k < row_start[i + 1], by increasing column. Memory is linear in the number
+// of nonzeros, and the compressed columns of the matrix are the compressed rows of transposed()
+template<typename Field = BigNumber::Rational>
+class SparseMatrix {
+public:
+    struct Entry {
+        size_t row;
+        size_t column;
+        Field value;
+    };
+
+private:
+    size_t m;
+    size_t n;
+    std::vector<size_t> row_start;
+    std::vector<size_t> column;
+    std::vector<Field> value;
+
+    // rows per task of a parallel product
+    static constexpr size_t row_grain = 1024;
+
+public:
+    // the m x n matrix with the given entries; entries at the same place are added up, and entries outside
+    // the matrix throw std::invalid_argument
+    SparseMatrix(size_t m, size_t n, std::vector<Entry> entries) : m(m), n(n), row_start(m + 1, 0) {
+        for (const Entry& entry : entries) {
+            if (entry.row >= m || entry.column >= n) throw std::invalid_argument("SparseMatrix entry lies outside the matrix");
+        }
+        std::sort(entries.begin(), entries.end(), [](const Entry& x, const Entry& y) {
+            return x.row != y.row ? x.row < y.row : x.column < y.column;
+        });
+        for (size_t k = 0; k < entries.size();) {
+            Entry sum = entries[k];
+            for (k++; k < entries.size() && entries[k].row == sum.row && entries[k].column == sum.column; k++) {
+                sum.value += entries[k].value;
+            }
+            if (!sum.value) continue;
+            row_start[sum.row + 1]++;
+            column.push_back(sum.column);
+            value.push_back(sum.value);
+        }
+        for (size_t i = 0; i < m; i++) row_start[i + 1] += row_start[i];
+    }
+
+    explicit SparseMatrix(const DynamicMatrix<Field>& x) : m(x.rows()), n(x.columns()), row_start(m + 1, 0) {
+        for (size_t i = 0; i < m; i++) {
+            for (size_t j = 0; j < n; j++) {
+                if (!x[i][j]) continue;
+                column.push_back(j);
+                value.push_back(x[i][j]);
+            }
+            row_start[i + 1] = column.size();
+        }
+    }
+
+    size_t rows() const {
+        return m;
+    }
+
+    size_t columns() const {
+        return n;
+    }
+
+    size_t nonzeros() const {
+        return value.size();
+    }
+
+    SparseMatrix<Field> transposed() const {
+        std::vector<Entry> entries;
+        entries.reserve(nonzeros());
+        for (size_t i = 0; i < m; i++) {
+            for (size_t k = row_start[i]; k < row_start[i + 1]; k++) entries.push_back({column[k], i, value[k]});
+        }
+        return SparseMatrix<Field>(n, m, std::move(entries));
+    }
+
+    DynamicMatrix<Field> to_dense() const {
+        DynamicMatrix<Field> result = DynamicMatrix<Field>::zero(m, n);
+        for (size_t i = 0; i < m; i++) {
+            for (size_t k = row_start[i]; k < row_start[i + 1]; k++) result[i][column[k]] = value[k];
+        }
+        return result;
+    }
+
+    // y = this * x, the rows spread over the thread pool
+    void multiply(const Field* x, Field* y) const {
+        parallel_for_entries<Field>(0, m, row_grain, [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; i++) {
+                Field sum = 0;
+                for (size_t k = row_start[i]; k < row_start[i + 1]; k++) sum += value[k] * x[column[k]];
+                y[i] = sum;
+            }
+        });
+    }
+};
+
+template<typename Field>
+std::vector<Field> operator*(const SparseMatrix<Field>& lhs, const std::vector<Field>& rhs) {
+    if (rhs.size() != lhs.columns()) throw std::invalid_argument("* needs a vector of as many entries as the matrix has columns");
+    std::vector<Field> result(lhs.rows());
+    lhs.multiply(rhs.data(), result.data());
+    return result;
+}
+
+// Wiedemann's black box algorithms for sparse matrices over a prime field, such as Residue<N> or DynResidue
+// with a prime modulus: the matrix is only ever multiplied by vectors, about twice its size times, so
+// time stays proportional to size times nonzeros and memory to the nonzeros. They are randomized and
+// meant for fields much bigger than the matrix, where an unlucky choice is rare and is retried. Over a
+// field not much bigger than the matrix every retry can fail, see solve and det
+namespace Wiedemann {
+// how often a solver retries after unlucky random choices
+static constexpr size_t attempts = 4;
+
+inline std::mt19937_64& random_engine() {
+    static thread_local std::mt19937_64 engine(0x5eed);
+    return engine;
+}
+
+template<typename Field>
+Field random_element() {
+    return Field(static_cast<int>(random_engine()() >> 33));
+}
+
+template<typename Field>
+std::vector<Field> random_vector(size_t n) {
+    std::vector<Field> result(n);
+    for (auto& x : result) x = random_element<Field>();
+    return result;
+}
+
+// the monic generator f of least degree of the linearly recurrent sequence s, by Berlekamp-Massey:
+// f[k] is the coefficient of x^k, and sum f[k] * s[i + k] is zero for every i. The first 2 * deg f
+// terms determine it
+template<typename Field>
+std::vector<Field> minimal_generator(const std::vector<Field>& s) {
+    // c is the connection polynomial, s[i] + c[1] s[i - 1] + ... + c[l] s[i - l] = 0
+    std::vector<Field> c = {1}, previous = {1};
+    size_t l = 0, shift = 1;
+    Field last = 1;
+    for (size_t i = 0; i < s.size(); i++) {
+        Field discrepancy = s[i];
+        for (size_t j = 1; j <= l; j++) discrepancy += c[j] * s[i - j];
+        if (!discrepancy) {
+            shift++;
+            continue;
+        }
+        std::vector<Field> copy = c;
+        Field factor = discrepancy / last;
+        if (c.size() < previous.size() + shift) c.resize(previous.size() + shift, Field(0));
+        for (size_t j = 0; j < previous.size(); j++) c[j + shift] -= factor * previous[j];
+        if (2 * l <= i) {
+            l = i + 1 - l;
+            previous = std::move(copy);
+            last = discrepancy;
+            shift = 1;
+        } else {
+            shift++;
+        }
+    }
+    c.resize(l + 1, Field(0));
+    return std::vector<Field>(c.rbegin(), c.rend());
+}
+
+// the generator of u^T B^i v for i < 2 * n, where apply(x, y) sets y = B x for n x n B
+template<typename Field, typename BlackBox>
+std::vector<Field> projected_generator(size_t n, const BlackBox& apply, const std::vector<Field>& u, std::vector<Field> v) {
+    std::vector<Field> sequence(2 * n), next(n);
+    for (size_t i = 0; i < 2 * n; i++) {
+        Field sum = 0;
+        for (size_t j = 0; j < n; j++) sum += u[j] * v[j];
+        sequence[i] = sum;
+        if (i + 1 < 2 * n) {
+            apply(v.data(), next.data());
+            std::swap(v, next);
+        }
+    }
+    return minimal_generator(sequence);
+}
+
+// the black box solvers take the place of Matrix's static_assert(M == N)
+template<typename Field>
+void require_square(const SparseMatrix<Field>& a, const char* operation) {
+    if (a.rows() != a.columns()) throw std::invalid_argument(std::string(operation) + " needs a square matrix");
+}
+
+// a solution of a x = b for a nonsingular square a: f(a) b = 0 for the generator f of u^T a^i b with
+// high probability, and then x = -(f(a) - f(0)) b / (f(0) a). Returns false when a looks singular,
+// which is also what happens to a consistent system when every attempt was unlucky: this is likely when
+// the field is not much bigger than n, so false only proves singularity over large fields
+template<typename Field>
+bool solve(const SparseMatrix<Field>& a, const std::vector<Field>& b, std::vector<Field>& x) {
+    require_square(a, "solve");
+    if (b.size() != a.rows()) throw std::invalid_argument("solve needs a right-hand side of as many entries as the matrix has rows");
+    size_t n = a.columns();
+    auto apply = [&a](const Field* from, Field* to) {
+        a.multiply(from, to);
+    };
+    for (size_t attempt = 0; attempt < attempts; attempt++) {
+        std::vector<Field> f = projected_generator(n, apply, random_vector<Field>(n), b);
+        if (!f[0]) continue;
+        // y = sum f[k] a^(k - 1) b by Horner's rule
+        std::vector<Field> y(n, Field(0)), product(n);
+        for (size_t k = f.size() - 1; k >= 1; k--) {
+            a.multiply(y.data(), product.data());
+            for (size_t j = 0; j < n; j++) y[j] = product[j] + f[k] * b[j];
+        }
+        Field scale = -(Field(1) / f[0]);
+        for (auto& entry : y) entry *= scale;
+        if (a * y == b) {
+            x = std::move(y);
+            return true;
+        }
+    }
+    return false;
+}
+
+// det a for a square a. With a random diagonal d, the minimal polynomial of a d is its characteristic
+// polynomial with high probability, and its constant term gives det(a d) = det a * prod d. A zero constant
+// term proves det a = 0; if no attempt reaches degree n, which is certain when the field has fewer than n
+// nonzero elements, std::runtime_error is thrown rather than a guess
+template<typename Field>
+Field det(const SparseMatrix<Field>& a) {
+    require_square(a, "det");
+    size_t n = a.columns();
+    if (n == 0) return 1;
+    for (size_t attempt = 0; attempt < attempts; attempt++) {
+        std::vector<Field> d(n);
+        Field scale = 1;
+        for (auto& entry : d) {
+            do entry = random_element<Field>(); while (!entry);
+            scale *= entry;
+        }
+        std::vector<Field> scaled(n);
+        auto apply = [&](const Field* from, Field* to) {
+            for (size_t j = 0; j < n; j++) scaled[j] = d[j] * from[j];
+            a.multiply(scaled.data(), to);
+        };
+        std::vector<Field> f = projected_generator(n, apply, random_vector<Field>(n), random_vector<Field>(n));
+        // zero is a root of the generator only if it is an eigenvalue
+        if (!f[0]) return 0;
+        if (f.size() != n + 1) continue;
+        Field result = f[0] / scale;
+        return n % 2 ? -result : result;
+    }
+    throw std::runtime_error("det found no generator of full degree, the field may be too small for the matrix");
+}
+
+// rank a, which is the rank of b = d1 a^T d2 a d1 for random diagonals d1 and d2; the minimal polynomial of b
+// is x^e times a polynomial of degree rank b with high probability, e being 0 or 1. Each trial can only
+// come out low, so the best of two is taken
+template<typename Field>
+size_t rank(const SparseMatrix<Field>& a) {
+    size_t m = a.rows(), n = a.columns();
+    SparseMatrix<Field> transposed = a.transposed();
+    size_t best = 0;
+    for (size_t trial = 0; trial < 2; trial++) {
+        std::vector<Field> d1 = random_vector<Field>(n), d2 = random_vector<Field>(m);
+        std::vector<Field> scaled(n), middle(m);
+        auto apply = [&](const Field* from, Field* to) {
+            for (size_t j = 0; j < n; j++) scaled[j] = d1[j] * from[j];
+            a.multiply(scaled.data(), middle.data());
+            for (size_t i = 0; i < m; i++) middle[i] *= d2[i];
+            transposed.multiply(middle.data(), to);
+            for (size_t j = 0; j < n; j++) to[j] *= d1[j];
+        };
+        std::vector<Field> f = projected_generator(n, apply, random_vector<Field>(n), random_vector<Field>(n));
+        best = std::max(best, f.size() - 1 - (f[0] ? 0 : 1));
+    }
+    return best;
+}
+}
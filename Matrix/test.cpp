@@ -1,9 +1,713 @@
 #include <vector>
 #include <fstream>
+#include <random>
 #include "matrix.h"
 
+std::mt19937_64 rng(2024);
+
+template<typename Field>
+using Rows = std::vector<std::vector<Field>>;
+
+void check(bool condition, const std::string& message)
+{
+	if (!condition)
+		throw std::runtime_error(message);
+}
+
+// an m x n matrix of integers in [-range, range], as rows
+template<typename Field>
+Rows<Field> random_rows(size_t m, size_t n, int range)
+{
+	Rows<Field> x(m, std::vector<Field>(n));
+	for (auto& row : x)
+		for (auto& entry : row)
+			entry = static_cast<int>(rng() % (2 * range + 1)) - range;
+	return x;
+}
+
+template<typename Field, typename MatrixType>
+Rows<Field> rows_of(const MatrixType& x, size_t m, size_t n)
+{
+	Rows<Field> result(m, std::vector<Field>(n));
+	for (size_t i = 0; i < m; ++i)
+		for (size_t j = 0; j < n; ++j)
+			result[i][j] = x[i][j];
+	return result;
+}
+
+// the basecase everything is checked against: the textbook algorithms on rows of entries
+
+template<typename Field>
+Rows<Field> naive_product(const Rows<Field>& a, const Rows<Field>& b)
+{
+	Rows<Field> c(a.size(), std::vector<Field>(b[0].size(), Field(0)));
+	for (size_t i = 0; i < a.size(); ++i)
+		for (size_t k = 0; k < b.size(); ++k)
+			for (size_t j = 0; j < b[0].size(); ++j)
+				c[i][j] += a[i][k] * b[k][j];
+	return c;
+}
+
+// Gaussian elimination with a division per entry; returns the rank and sets det for square x
+template<typename Field>
+size_t naive_eliminate(Rows<Field> x, Field& det)
+{
+	size_t rank = 0;
+	det = 1;
+	for (size_t c = 0; c < x[0].size() && rank < x.size(); ++c) {
+		size_t p = rank;
+		while (p < x.size() && x[p][c] == Field(0))
+			++p;
+		if (p == x.size())
+			continue;
+		if (p != rank) {
+			std::swap(x[p], x[rank]);
+			det = Field(0) - det;
+		}
+		det *= x[rank][c];
+		for (size_t i = rank + 1; i < x.size(); ++i) {
+			Field factor = x[i][c] / x[rank][c];
+			for (size_t j = c; j < x[0].size(); ++j)
+				x[i][j] -= factor * x[rank][j];
+		}
+		++rank;
+	}
+	if (rank < x.size())
+		det = 0;
+	return rank;
+}
+
+template<typename Field>
+Field naive_det(const Rows<Field>& x)
+{
+	Field det;
+	naive_eliminate(x, det);
+	return det;
+}
+
+template<typename Field>
+size_t naive_rank(const Rows<Field>& x)
+{
+	Field det;
+	return naive_eliminate(x, det);
+}
+
+// Gauss-Jordan on [x | I] for a nonsingular x
+template<typename Field>
+Rows<Field> naive_inverse(Rows<Field> x)
+{
+	size_t n = x.size();
+	Rows<Field> y(n, std::vector<Field>(n, Field(0)));
+	for (size_t i = 0; i < n; ++i)
+		y[i][i] = 1;
+	for (size_t c = 0; c < n; ++c) {
+		size_t p = c;
+		while (x[p][c] == Field(0))
+			++p;
+		std::swap(x[p], x[c]);
+		std::swap(y[p], y[c]);
+		Field pivot = x[c][c];
+		for (size_t j = 0; j < n; ++j) {
+			x[c][j] /= pivot;
+			y[c][j] /= pivot;
+		}
+		for (size_t i = 0; i < n; ++i) {
+			if (i == c || x[i][c] == Field(0))
+				continue;
+			Field factor = x[i][c];
+			for (size_t j = 0; j < n; ++j) {
+				x[i][j] -= factor * x[c][j];
+				y[i][j] -= factor * y[c][j];
+			}
+		}
+	}
+	return y;
+}
+
+// Rational entries with small numerators and denominators, every third one whole
+Rows<Rational> random_fractions(size_t m, size_t n)
+{
+	Rows<Rational> x = random_rows<Rational>(m, n, 50);
+	for (auto& row : x)
+		for (auto& entry : row)
+			if (rng() % 3)
+				entry /= Rational(static_cast<int>(rng() % 30 + 1));
+	return x;
+}
+
+template<size_t N>
+void check_bareiss()
+{
+	for (int attempt = 0; attempt < 5; ++attempt) {
+		Rows<Rational> x = attempt % 2 ? random_fractions(N, N) : random_rows<Rational>(N, N, 1000000);
+		SquareMatrix<N> a = x;
+		Rational det = naive_det(x);
+		check(a.det() == det, "Bareiss determinant differs from Gaussian elimination.");
+		check(a.rank() == naive_rank(x), "Bareiss rank differs from Gaussian elimination.");
+		if (det != 0)
+			check(rows_of<Rational>(a.inverted(), N, N) == naive_inverse(x), "Bareiss inverse differs from Gauss-Jordan.");
+		if (N > 1) {
+			// a row that is a combination of two others
+			for (size_t j = 0; j < N; ++j)
+				x[N - 1][j] = x[0][j] * Rational(3) - x[(N - 1) / 2][j] / Rational(7);
+			check(SquareMatrix<N>(x).det() == 0 && SquareMatrix<N>(x).rank() == N - 1, "Singular matrix is not found singular.");
+		}
+	}
+}
+
+void test_bareiss()
+{
+	// below Elimination::modular_size, det and inverse of Rational matrices take Bareiss elimination, rank always does
+	check_bareiss<1>();
+	check_bareiss<2>();
+	check_bareiss<3>();
+	check_bareiss<5>();
+	check_bareiss<7>();
+	for (auto [m, n, r] : std::vector<std::tuple<size_t, size_t, size_t>>{{3, 5, 2}, {6, 4, 4}, {12, 15, 9}, {20, 20, 13}}) {
+		Rows<Rational> x = naive_product(random_fractions(m, r), random_fractions(r, n));
+		check(DynamicMatrix<Rational>(x).rank() == naive_rank(x) && naive_rank(x) == r, "Bareiss rank differs from Gaussian elimination.");
+	}
+	std::cerr << "Bareiss elimination passed!\n";
+}
+
+template<size_t M, size_t N, typename Field>
+void check_storage()
+{
+	Rows<Field> x = random_rows<Field>(M, N, 1000), y = random_rows<Field>(M, N, 1000), z = random_rows<Field>(N, 5, 1000);
+	Matrix<M, N, Field> a = x, b = y;
+	const Matrix<M, N, Field>& c = a;
+	bool row_major = true;
+	for (size_t i = 0; i < M; ++i)
+		for (size_t j = 0; j < N; ++j)
+			row_major = row_major && c.data()[i * N + j] == x[i][j] && &c.getRow(i)[j] == &c[i][j]
+				&& &c.getColumn(j)[i] == &c[i][j] && c.getColumn(j).getColumn()[i] == x[i][j];
+	check(row_major, "Entries are not stored row by row.");
+	if (!std::is_same<Row::Storage<M, N, Field>, std::array<Field, M * N>>::value)
+		check(reinterpret_cast<uintptr_t>(c.data()) % 64 == 0, "Allocated entries are not aligned to a cache line.");
+	Matrix<M, N, Field> copy = a, moved = std::move(copy);
+	check(moved == a && rows_of<Field>(a.transposed(), N, M) == rows_of<Field>(DynamicMatrix<Field>(x).transposed(), N, M),
+		"Copied, moved or transposed matrix differs.");
+	Rows<Field> sum = x, difference = x;
+	for (size_t i = 0; i < M; ++i)
+		for (size_t j = 0; j < N; ++j) {
+			sum[i][j] += y[i][j];
+			difference[i][j] -= y[i][j];
+		}
+	check(rows_of<Field>(a + b, M, N) == sum && rows_of<Field>(a - b, M, N) == difference, "Sum or difference differs from the entrywise one.");
+	check(rows_of<Field>(a * Matrix<N, 5, Field>(z), M, 5) == naive_product(x, z), "Product differs from the naive one.");
+}
+
+void test_storage()
+{
+	// small matrices of trivially copyable entries live inside the object, up to Row::inline_matrix_bytes
+	static_assert(std::is_same<Row::Storage<22, 23, Residue<17>>, std::array<Residue<17>, 22 * 23>>::value);
+	static_assert(!std::is_same<Row::Storage<23, 23, Residue<17>>, std::array<Residue<17>, 23 * 23>>::value);
+	check_storage<1, 1, Residue<17>>();
+	check_storage<3, 7, Residue<17>>();
+	check_storage<22, 23, Residue<17>>();
+	check_storage<23, 23, Residue<17>>();
+	check_storage<40, 30, Residue<1000000007>>();
+	check_storage<4, 6, Rational>();
+	check_storage<25, 23, Rational>();
+	std::cerr << "Row-major storage passed!\n";
+}
+
+template<typename Field>
+void check_product(size_t m, size_t n, size_t k, int range)
+{
+	Rows<Field> x = random_rows<Field>(m, n, range), y = random_rows<Field>(n, k, range);
+	check(rows_of<Field>(DynamicMatrix<Field>(x) * DynamicMatrix<Field>(y), m, k) == naive_product(x, y),
+		"Blocked product differs from the naive one.");
+}
+
+void test_blocked_product()
+{
+	// shapes that leave partial register tiles and take several blocks of the inner dimension (kc is 256 for
+	// 8-byte entries), of the rows of a and of the columns of b
+	std::vector<std::tuple<size_t, size_t, size_t>> shapes = {{1, 1, 1}, {1, 300, 1}, {3, 5, 7}, {4, 8, 8}, {13, 1, 17},
+		{100, 100, 100}, {255, 257, 9}, {300, 520, 37}, {9, 30, 4100}};
+	for (auto [m, n, k] : shapes) {
+		check_product<double>(m, n, k, 1000);
+		check_product<long long>(m, n, k, 1000000);
+		check_product<Residue<1000000007>>(m, n, k, 1000000);
+	}
+	check_product<Rational>(7, 9, 5, 1000);
+	Rows<Rational> x = random_fractions(11, 6), y = random_fractions(6, 13);
+	check(rows_of<Rational>(DynamicMatrix<Rational>(x) * DynamicMatrix<Rational>(y), 11, 13) == naive_product(x, y),
+		"Blocked product of fractions differs from the naive one.");
+	std::cerr << "Blocked product passed!\n";
+}
+
+// residues spread over the whole range, every other one close to N, whose products overflow the sums soonest
+template<size_t N>
+Rows<Residue<N>> random_residues(size_t m, size_t n)
+{
+	Rows<Residue<N>> x(m, std::vector<Residue<N>>(n));
+	for (auto& row : x)
+		for (auto& entry : row)
+			entry = rng() % 2 ? -Residue<N>(static_cast<int>(rng() % 5 + 1))
+				: Residue<N>(static_cast<int>(rng() >> 33)) * Residue<N>(static_cast<int>(rng() >> 33)) + Residue<N>(static_cast<int>(rng() >> 33));
+	return x;
+}
+
+template<size_t N>
+void check_residue_product(size_t m, size_t n, size_t k)
+{
+	Rows<Residue<N>> x = random_residues<N>(m, n), y = random_residues<N>(n, k);
+	DynamicMatrix<Residue<N>> product = DynamicMatrix<Residue<N>>(x) * DynamicMatrix<Residue<N>>(y);
+	// the reference reduces every product and every sum
+	for (size_t i = 0; i < m; ++i)
+		for (size_t j = 0; j < k; ++j) {
+			unsigned __int128 sum = 0;
+			for (size_t p = 0; p < n; ++p)
+				sum = (sum + static_cast<unsigned __int128>(x[i][p].get_value()) * y[p][j].get_value() % N) % N;
+			check(product[i][j].get_value() == static_cast<size_t>(sum), "Residue product differs from the one reduced at each step.");
+		}
+}
+
+template<size_t N>
+void check_residue_products()
+{
+	for (auto [m, n, k] : std::vector<std::tuple<size_t, size_t, size_t>>{{1, 1, 1}, {5, 7, 3}, {20, 600, 30}, {33, 2000, 9}})
+		check_residue_product<N>(m, n, k);
+}
+
+void test_residue_product()
+{
+	// moduli up to 2^32 are summed in 64 bits and folded, from a fold at every step to almost never; bigger
+	// ones in 128 bits and reduced, in Montgomery form for odd moduli below 2^63 and Barrett form otherwise
+	check_residue_products<2>();
+	check_residue_products<65537>();
+	check_residue_products<2147483647>();
+	check_residue_products<4294967291>();
+	check_residue_products<4294967296>();
+	check_residue_products<4294967311>();
+	check_residue_products<1000000000000000003>();
+	check_residue_products<1000000000000000000>();
+	check_residue_products<18446744073709551557ull>();
+	std::cerr << "Residue product passed!\n";
+}
+
+// the residue of v, built from 22-bit pieces since residues are constructed from int
+template<size_t N>
+Residue<N> residue_of(uint64_t v)
+{
+	const Residue<N> shift = 1 << 22;
+	Residue<N> result = static_cast<int>(v >> 44);
+	result = result * shift + Residue<N>(static_cast<int>((v >> 22) & ((1 << 22) - 1)));
+	return result * shift + Residue<N>(static_cast<int>(v & ((1 << 22) - 1)));
+}
+
+template<size_t N>
+void check_residue_arithmetic()
+{
+	std::vector<uint64_t> values = {0, 1, 2, N - 1, N - 2, N / 2, N / 2 + 1, uint64_t(1) << 32, UINT64_MAX};
+	for (int i = 0; i < 200; ++i)
+		values.push_back(rng());
+	for (uint64_t u : values) {
+		uint64_t x = u % N;
+		Residue<N> a = residue_of<N>(u);
+		check(a.get_value() == x && (-a).get_value() == (N - x) % N, "Residue or its negation differs from the reference.");
+		for (int j = 0; j < 20; ++j) {
+			uint64_t v = values[rng() % values.size()], y = v % N;
+			Residue<N> b = residue_of<N>(v);
+			check((a + b).get_value() == static_cast<uint64_t>((static_cast<unsigned __int128>(x) + y) % N)
+				&& (a - b).get_value() == static_cast<uint64_t>((static_cast<unsigned __int128>(x) + N - y) % N)
+				&& (a * b).get_value() == static_cast<uint64_t>(static_cast<unsigned __int128>(x) * y % N),
+				"Residue arithmetic differs from the reference.");
+			if constexpr (Modular::is_prime(N))
+				if (y != 0)
+					check((a / b) * b == a, "Residue quotient times the divisor differs from the dividend.");
+		}
+	}
+}
+
+void test_residue_arithmetic()
+{
+	// multiplication by x * y % N up to 2^32, Montgomery form for odd moduli above that and below 2^63,
+	// Barrett reduction for the rest; is_prime decides division at compile time for all of them
+	static_assert(Modular::is_prime(4294967311) && Modular::is_prime(1000000000000000003) && Modular::is_prime(18446744073709551557ull)
+		&& !Modular::is_prime(4294967297) && !Modular::is_prime(3215031751) && !Modular::is_prime(1));
+	check_residue_arithmetic<2>();
+	check_residue_arithmetic<17>();
+	check_residue_arithmetic<1000000007>();
+	check_residue_arithmetic<4294967291>();
+	check_residue_arithmetic<4294967296>();
+	check_residue_arithmetic<4294967297>();
+	check_residue_arithmetic<4294967311>();
+	check_residue_arithmetic<1000000000000000003>();
+	check_residue_arithmetic<9223372036854775783>();
+	check_residue_arithmetic<1000000000000000000>();
+	check_residue_arithmetic<18446744073709551557ull>();
+	std::cerr << "Residue arithmetic passed!\n";
+}
+
+// right-to-left binary powering, one bit at a time
+template<typename Square>
+Square naive_power(Square x, const BigInteger& exponent, const Square& identity)
+{
+	Square result = identity;
+	for (BigInteger e = exponent; e != 0; e /= 2) {
+		if (e % 2 != 0)
+			result = result * x;
+		x = x * x;
+	}
+	return result;
+}
+
+void test_power()
+{
+	using F = Residue<1000000007>;
+	SquareMatrix<4, F> x = rows_of<F>(DynamicMatrix<F>(random_rows<F>(4, 4, 1000000)), 4, 4), identity;
+	DynamicMatrix<F> y = random_rows<F>(5, 5, 1000000);
+	SquareMatrix<4, F> repeated = identity;
+	for (int e = 0; e < 70; ++e, repeated = repeated * x) {
+		check(pow(x, e) == repeated && pow(x, static_cast<unsigned>(e)) == repeated && pow(x, BigInteger(e)) == repeated,
+			"Power differs from repeated multiplication.");
+		check(pow(x, -e) * repeated == identity && pow(x, BigInteger(-e)) == pow(x.inverted(), e), "Negative power is not the inverse.");
+	}
+	// exponents long enough for every window width, up to 6 bits from about 670 bits on
+	for (size_t digits : {3, 10, 30, 80, 150, 250, 400}) {
+		std::string s(digits, '1');
+		for (size_t i = 1; i < digits; ++i)
+			s[i] = static_cast<char>('0' + rng() % 10);
+		BigInteger e(s);
+		check(pow(x, e) == naive_power(x, e, identity) && pow(y, e) == naive_power(y, e, DynamicMatrix<F>(5)),
+			"Power differs from binary powering.");
+		check(pow(y, -e) == naive_power(y.inverted(), e, DynamicMatrix<F>(5)), "Negative power differs from binary powering of the inverse.");
+	}
+	check(pow(x, 9223372036854775807ll) == naive_power(x, BigInteger("9223372036854775807"), identity)
+		&& pow(x, -9223372036854775807ll - 1) == naive_power(x.inverted(), BigInteger("9223372036854775808"), identity),
+		"Power with a 64-bit exponent differs from binary powering.");
+	// Fibonacci numbers over the rationals
+	SquareMatrix<2> fibonacci = {{1, 1}, {1, 0}};
+	Rational a = 0, b = 1;
+	for (int i = 0; i < 300; ++i) {
+		b += a;
+		std::swap(a, b);
+	}
+	check(pow(fibonacci, 300)[0][1] == a && pow(fibonacci, -300)[0][1] == -a, "Power of the Fibonacci matrix is wrong.");
+	std::cerr << "Matrix power passed!\n";
+}
+
+template<typename Field>
+void check_strassen(size_t n)
+{
+	Rows<Field> x = random_rows<Field>(n, n, 1000000), y = random_rows<Field>(n, n, 1000000);
+	DynamicMatrix<Field> a = x;
+	a *= DynamicMatrix<Field>(y);
+	check(rows_of<Field>(a, n, n) == naive_product(x, y), "Strassen-Winograd product differs from the naive one.");
+}
+
+void test_strassen()
+{
+	// square products above Kernel::Traits::strassen_threshold = 256 recurse, peeling a row and column off
+	// odd sizes; 520 goes two levels down
+	check_strassen<Residue<1000000007>>(256);
+	check_strassen<Residue<1000000007>>(257);
+	check_strassen<Residue<1000000007>>(300);
+	check_strassen<Residue<1000000007>>(520);
+	check_strassen<Residue<4294967311>>(301);
+	using F = Residue<17>;
+	Rows<F> x = random_rows<F>(260, 260, 8);
+	SquareMatrix<260, F> a = x;
+	a *= a;
+	check(rows_of<F>(a, 260, 260) == naive_product(x, x), "Strassen-Winograd square differs from the naive one.");
+	std::cerr << "Strassen-Winograd product passed!\n";
+}
+
+template<typename Field>
+void check_elimination(const Rows<Field>& x)
+{
+	DynamicMatrix<Field> a = x;
+	size_t rank = naive_rank(x);
+	check(a.rank() == rank, "Rank differs from Gaussian elimination.");
+	if (x.size() != x[0].size())
+		return;
+	Field det = naive_det(x);
+	check(a.det() == det, "Determinant differs from Gaussian elimination.");
+	if (det != Field(0))
+		check(rows_of<Field>(a.inverted(), x.size(), x.size()) == naive_inverse(x), "Inverse differs from Gauss-Jordan.");
+}
+
+template<typename Field>
+void check_eliminations()
+{
+	for (size_t n : {127, 128, 129, 200})
+		check_elimination(random_rows<Field>(n, n, 1000000));
+	// rank deficient, and with pivots missing inside a block of columns
+	check_elimination(naive_product(random_rows<Field>(150, 100, 100), random_rows<Field>(100, 180, 100)));
+	check_elimination(naive_product(random_rows<Field>(200, 130, 100), random_rows<Field>(130, 200, 100)));
+	Rows<Field> x = random_rows<Field>(160, 160, 1000000);
+	for (auto& row : x)
+		std::fill(row.begin() + 10, row.begin() + 20, Field(0));
+	check_elimination(x);
+	for (size_t i = 0; i < 160; ++i)
+		x[i][10 + i % 10] = 1;
+	check_elimination(x);
+}
+
+void test_parallel_elimination()
+{
+	// from Elimination::blocked_elimination_size = 128 on, elimination goes a panel of 64 columns at a time;
+	// run it serially and with more threads than cores
+	DynamicMatrix<double> a = random_rows<double>(200, 200, 1000);
+	Parallel::set_thread_count(1);
+	check_eliminations<Residue<1000000007>>();
+	double det = a.det();
+	DynamicMatrix<double> inverse = a.inverted();
+	Parallel::set_thread_count(4);
+	check_eliminations<Residue<1000000007>>();
+	check_eliminations<Residue<4294967311>>();
+	// rows are updated independently, so floating point results do not depend on the threads either
+	check(a.det() == det && a.inverted() == inverse, "Parallel elimination of doubles differs from the serial one.");
+	Parallel::set_thread_count(std::thread::hardware_concurrency());
+	std::cerr << "Parallel elimination passed!\n";
+}
+
+void check_modular(const Rows<Rational>& x)
+{
+	DynamicMatrix<Rational> a = x;
+	Rational det = naive_det(x);
+	check(a.det() == det, "Determinant from the modular images differs from Gaussian elimination.");
+	if (det != 0)
+		check(rows_of<Rational>(a.inverted(), x.size(), x.size()) == naive_inverse(x), "Inverse from the modular images differs from Gauss-Jordan.");
+}
+
+void test_modular_rational()
+{
+	// from Elimination::modular_size = 8 on, det and inverse of Rational matrices come from their images
+	// modulo word-sized primes; the entries here need up to a few dozen of them
+	for (size_t n : {8, 9, 12, 20}) {
+		check_modular(random_rows<Rational>(n, n, 1000));
+		check_modular(random_fractions(n, n));
+		Rows<Rational> x = random_rows<Rational>(n, n, 1000000);
+		for (auto& row : x)
+			for (auto& entry : row)
+				entry *= Rational(BigInteger("-123456789012345678901234567890")) * Rational(static_cast<int>(rng() % 1000 + 1));
+		check_modular(x);
+		x[n - 1] = x[0];
+		check_modular(x);
+	}
+	SquareMatrix<10> unimodular;
+	for (int i = 0; i < 10; ++i)
+		for (int j = i + 1; j < 10; ++j)
+			unimodular[i][j] = static_cast<int>(rng() % 200) - 100;
+	check(unimodular.det() == 1 && (unimodular.transposed() * unimodular).det() == 1 && unimodular * unimodular.inverted() == SquareMatrix<10>(),
+		"Unimodular matrix has the wrong determinant or inverse.");
+	std::cerr << "Modular determinant and inverse passed!\n";
+}
+
+// the DynResidue counterpart of each Residue<N> entry, under the modulus N of the calling thread
+template<size_t N>
+DynamicMatrix<DynResidue> to_dynamic(const Rows<Residue<N>>& x)
+{
+	DynamicMatrix<DynResidue> result = DynamicMatrix<DynResidue>::zero(x.size(), x[0].size());
+	const DynResidue shift = 1 << 22;
+	for (size_t i = 0; i < x.size(); ++i)
+		for (size_t j = 0; j < x[0].size(); ++j) {
+			uint64_t v = x[i][j].get_value();
+			result[i][j] = (DynResidue(v >> 44) * shift + DynResidue((v >> 22) & ((1 << 22) - 1))) * shift + DynResidue(v & ((1 << 22) - 1));
+		}
+	return result;
+}
+
+template<size_t N>
+void check_dynamic_residues()
+{
+	DynResidue::ModulusScope scope(N);
+	for (auto [m, n, k] : std::vector<std::tuple<size_t, size_t, size_t>>{{1, 1, 1}, {3, 5, 2}, {40, 300, 20}, {130, 130, 130}, {260, 260, 260}}) {
+		Rows<Residue<N>> x = random_residues<N>(m, n), y = random_residues<N>(n, k);
+		DynamicMatrix<Residue<N>> a = x, b = y;
+		DynamicMatrix<DynResidue> c = to_dynamic(x), d = to_dynamic(y);
+		check(c * d == to_dynamic(rows_of<Residue<N>>(a * b, m, k)), "DynResidue product differs from the Residue<N> one.");
+		if constexpr (Modular::is_prime(N)) {
+			check(c.rank() == a.rank(), "DynResidue rank differs from the Residue<N> one.");
+			if (m != n)
+				continue;
+			check(c.det() == to_dynamic(Rows<Residue<N>>{{a.det()}})[0][0], "DynResidue determinant differs from the Residue<N> one.");
+			check(c.inverted() == to_dynamic(rows_of<Residue<N>>(a.inverted(), n, n)) && pow(c, -5) == to_dynamic(rows_of<Residue<N>>(pow(a, -5), n, n)),
+				"DynResidue inverse or power differs from the Residue<N> one.");
+		}
+	}
+}
+
+void test_dynamic()
+{
+	// a run-time modulus takes the same kernel and elimination as Residue<N>, and must agree with it
+	check_dynamic_residues<1000000007>();
+	check_dynamic_residues<4294967311>();
+	check_dynamic_residues<18446744073709551557ull>();
+	check_dynamic_residues<4294967296>();
+	check_dynamic_residues<18446744073709551615ull>();
+	// threads with moduli of their own, each running the parallel elimination
+	Parallel::set_thread_count(4);
+	Rows<Residue<1000000007>> x = random_residues<1000000007>(150, 150);
+	Rows<Residue<998244353>> y = random_residues<998244353>(150, 150);
+	uint64_t det_x = DynamicMatrix<Residue<1000000007>>(x).det().get_value(), det_y = DynamicMatrix<Residue<998244353>>(y).det().get_value();
+	uint64_t results[2] = {};
+	std::thread first([&] {
+		DynResidue::ModulusScope scope(1000000007);
+		results[0] = to_dynamic(x).det().get_value();
+	});
+	std::thread second([&] {
+		DynResidue::ModulusScope scope(998244353);
+		results[1] = to_dynamic(y).det().get_value();
+	});
+	first.join();
+	second.join();
+	Parallel::set_thread_count(std::thread::hardware_concurrency());
+	check(results[0] == det_x && results[1] == det_y, "Determinants under per-thread moduli differ from the Residue<N> ones.");
+	// the square-only operations reject other shapes at run time
+	DynamicMatrix<Rational> rectangular(3, 4);
+	int rejected = 0;
+	for (auto operation : {+[](DynamicMatrix<Rational>& a) { a.det(); }, +[](DynamicMatrix<Rational>& a) { a.trace(); },
+		+[](DynamicMatrix<Rational>& a) { a.invert(); }}) {
+		try {
+			operation(rectangular);
+		} catch (const std::invalid_argument&) {
+			++rejected;
+		}
+	}
+	for (auto operation : {+[](DynamicMatrix<Rational>& a) { pow(a, 0); }, +[](DynamicMatrix<Rational>& a) { pow(a, 2u); },
+		+[](DynamicMatrix<Rational>& a) { pow(a, BigInteger(5)); }}) {
+		try {
+			operation(rectangular);
+		} catch (const std::invalid_argument&) {
+			++rejected;
+		}
+	}
+	check(rejected == 6, "A non-square DynamicMatrix is not rejected.");
+	// and +, - and * reject operands of mismatched sizes
+	rejected = 0;
+	for (auto operation : {+[](DynamicMatrix<Rational>& a) { a += DynamicMatrix<Rational>(4, 3); },
+		+[](DynamicMatrix<Rational>& a) { a -= DynamicMatrix<Rational>(3, 5); },
+		+[](DynamicMatrix<Rational>& a) { a *= DynamicMatrix<Rational>(3, 4); },
+		+[](DynamicMatrix<Rational>& a) { a = a * DynamicMatrix<Rational>(3); },
+		+[](DynamicMatrix<Rational>& a) { a = a + DynamicMatrix<Rational>(4); }}) {
+		try {
+			operation(rectangular);
+		} catch (const std::invalid_argument&) {
+			++rejected;
+		}
+	}
+	check(rejected == 5 && rectangular == DynamicMatrix<Rational>(3, 4), "Mismatched DynamicMatrix sizes are not rejected.");
+	check((rectangular * DynamicMatrix<Rational>(4, 2)).columns() == 2, "A product of matching sizes is rejected.");
+	std::cerr << "Run-time sized matrices passed!\n";
+}
+
+// an m x n matrix with about per_row random entries in each row, some of them at the same place
+template<typename Field>
+SparseMatrix<Field> random_sparse(size_t m, size_t n, size_t per_row)
+{
+	std::vector<typename SparseMatrix<Field>::Entry> entries;
+	for (size_t i = 0; i < m; ++i)
+		for (size_t t = 0; t < per_row; ++t)
+			entries.push_back({i, rng() % n, Field(static_cast<int>(rng() % 2000000) - 1000000)});
+	return SparseMatrix<Field>(m, n, entries);
+}
+
+template<typename Field>
+void check_sparse(const SparseMatrix<Field>& a)
+{
+	DynamicMatrix<Field> dense = a.to_dense();
+	check(SparseMatrix<Field>(dense).to_dense() == dense && a.transposed().to_dense() == dense.transposed(),
+		"Sparse matrix differs from its dense form.");
+	std::vector<Field> x(a.columns());
+	for (auto& entry : x)
+		entry = static_cast<int>(rng() % 1000);
+	DynamicMatrix<Field> column = DynamicMatrix<Field>::zero(a.columns(), 1);
+	for (size_t j = 0; j < a.columns(); ++j)
+		column[j][0] = x[j];
+	check(DynamicMatrix<Field>(std::vector<std::vector<Field>>{a * x}).transposed() == dense * column,
+		"Sparse product differs from the dense one.");
+	check(Wiedemann::rank(a) == dense.rank(), "Wiedemann rank differs from elimination.");
+	if (a.rows() != a.columns())
+		return;
+	Field det = dense.det();
+	check(Wiedemann::det(a) == det, "Wiedemann determinant differs from elimination.");
+	std::vector<Field> b = a * x, solution;
+	bool solved = Wiedemann::solve(a, b, solution);
+	// b is in the image of a, so a singular a may be solved as well
+	check((solved || det == Field(0)) && (!solved || a * solution == b), "Wiedemann solution does not solve the system.");
+}
+
+template<typename Field>
+void check_sparse_matrices()
+{
+	for (size_t n : {1, 2, 10, 60, 300}) {
+		check_sparse(random_sparse<Field>(n, n, 4));
+		check_sparse(random_sparse<Field>(n, n, 1));
+		check_sparse(random_sparse<Field>(n, n + 7, 3));
+		check_sparse(random_sparse<Field>(n + 7, n, 3));
+	}
+	// singular ones: a repeated row, and a product through a narrower matrix
+	std::vector<typename SparseMatrix<Field>::Entry> entries;
+	for (size_t j = 0; j < 50; j += 3)
+		for (size_t i : {7, 31})
+			entries.push_back({i, j, Field(static_cast<int>(j) + 1)});
+	SparseMatrix<Field> repeated(50, 50, entries);
+	check_sparse(SparseMatrix<Field>((random_sparse<Field>(50, 50, 4).to_dense() + repeated.to_dense())));
+	check_sparse(SparseMatrix<Field>(random_sparse<Field>(80, 30, 3).to_dense() * random_sparse<Field>(30, 80, 3).to_dense()));
+}
+
+void test_sparse()
+{
+	// Wiedemann's algorithms are randomized; over fields much bigger than the matrix they have to agree with
+	// elimination on the dense form
+	check_sparse_matrices<Residue<1000000007>>();
+	check_sparse_matrices<Residue<4294967311>>();
+	DynResidue::ModulusScope scope(998244353);
+	check_sparse_matrices<DynResidue>();
+	// over a field with fewer nonzero elements than the size, the random diagonal always has equal entries:
+	// the determinant of the identity cannot be found and must not be reported as zero
+	bool thrown = false;
+	try {
+		Wiedemann::det(SparseMatrix<Residue<17>>(DynamicMatrix<Residue<17>>(20)));
+	} catch (const std::runtime_error&) {
+		thrown = true;
+	}
+	check(thrown, "Wiedemann determinant over a too small field is not rejected.");
+	thrown = false;
+	try {
+		Wiedemann::det(random_sparse<Residue<1000000007>>(5, 6, 2));
+	} catch (const std::invalid_argument&) {
+		thrown = true;
+	}
+	check(thrown, "Wiedemann determinant of a non-square matrix is not rejected.");
+	// entries outside the matrix and vectors of the wrong length
+	using R = Residue<1000000007>;
+	SparseMatrix<R> square = random_sparse<R>(6, 6, 2);
+	std::vector<R> solution;
+	int rejected = 0;
+	for (auto operation : {std::function<void()>([] { SparseMatrix<R>(3, 4, {{3, 0, R(1)}}); }),
+		std::function<void()>([] { SparseMatrix<R>(3, 4, {{0, 4, R(1)}}); }),
+		std::function<void()>([&] { square * std::vector<R>(5); }),
+		std::function<void()>([&] { Wiedemann::solve(square, std::vector<R>(5), solution); })}) {
+		try {
+			operation();
+		} catch (const std::invalid_argument&) {
+			++rejected;
+		}
+	}
+	check(rejected == 4, "Sparse entries or vectors of the wrong size are not rejected.");
+	std::cerr << "Sparse matrices passed!\n";
+}
+
 int main()
 {
+	test_bareiss();
+	test_storage();
+	test_blocked_product();
+	test_residue_product();
+	test_residue_arithmetic();
+	test_power();
+	test_strassen();
+	test_parallel_elimination();
+	test_modular_rational();
+	test_dynamic();
+	test_sparse();
+
 	//first part
 	Residue<433494437> x = 1279;
 	std::cout << (x == 1279);
@@ -58,7 +762,7 @@ int main()
 
 	Matrix<4, 4, Residue<17>> F = newMatrix.inverted();
 	Matrix<4, 4, Residue<17>> G = F * newMatrix;
-	if (F * newMatrix != Matrix<4, 4, Residue<17>>())
+	if (G != Matrix<4, 4, Residue<17>>())
 		throw std::runtime_error("A*A^(-1) must be equal to unity matrix.");
 
 	std::cerr << "Tests over the Residue field passed!\n";
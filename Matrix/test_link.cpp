@@ -0,0 +1,24 @@
+// matrix.h and biginteger.h included from two translation units must link into one program:
+//     g++ -std=c++17 -pthread test_link.cpp test_link_other.cpp
+#include "../BigInteger/biginteger.h"
+#include "matrix.h"
+#include "matrix.h"
+
+size_t other_pool_size();
+BigNumber::Rational other_det();
+BigInteger other_gcd(const BigInteger& x, const BigInteger& y);
+
+int main() {
+	SquareMatrix<3> a = {{2, -1, 0}, {-1, 2, -1}, {0, -1, 2}};
+	if (a.det() != other_det() || a.det() != BigNumber::Rational(4))
+		throw std::runtime_error("det differs between translation units.");
+	if (other_gcd(BigInteger(84), BigInteger(-36)) != gcd(BigInteger(84), BigInteger(-36)))
+		throw std::runtime_error("gcd differs between translation units.");
+
+	// both translation units see the one shared pool
+	Parallel::set_thread_count(3);
+	if (other_pool_size() != 3)
+		throw std::runtime_error("Translation units must share one thread pool.");
+
+	std::cerr << "Translation units linked together!\n";
+}
@@ -0,0 +1,16 @@
+// the second translation unit of test_link.cpp
+#include "../BigInteger/biginteger.h"
+#include "matrix.h"
+
+size_t other_pool_size() {
+    return Parallel::pool().size();
+}
+
+BigNumber::Rational other_det() {
+    SquareMatrix<3> a = {{2, -1, 0}, {-1, 2, -1}, {0, -1, 2}};
+    return a.det();
+}
+
+BigInteger other_gcd(const BigInteger& x, const BigInteger& y) {
+    return gcd(x, y);
+}
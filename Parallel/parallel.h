@@ -0,0 +1,156 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <exception>
+#include <utility>
+
+namespace Parallel {
+// a fixed set of worker threads that runs the tasks of one job at a time together with the calling thread
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::mutex job_mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    const std::function<void(size_t)>* job = nullptr;
+    size_t next_task = 0;
+    size_t task_count = 0;
+    size_t unfinished = 0;
+    bool stopping = false;
+    // the first exception thrown by a task of the current job, rethrown by run
+    std::exception_ptr failure;
+
+    static bool& inside_task() {
+        static thread_local bool inside = false;
+        return inside;
+    }
+
+    // marks the thread as running a task for as long as it lives, however the task ends
+    struct TaskScope {
+        bool outer = inside_task();
+
+        TaskScope() {
+            inside_task() = true;
+        }
+
+        ~TaskScope() {
+            inside_task() = outer;
+        }
+    };
+
+    // runs tasks of the current job until none is left; the lock is held on entry and on exit.
+    // A throwing task still counts as finished, and its exception is kept for run
+    void work(std::unique_lock<std::mutex>& lock) {
+        while (next_task < task_count) {
+            size_t task = next_task++;
+            const std::function<void(size_t)>& f = *job;
+            lock.unlock();
+            std::exception_ptr error;
+            try {
+                TaskScope scope;
+                f(task);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            lock.lock();
+            if (error && !failure) failure = error;
+            if (--unfinished == 0) finished.notify_all();
+        }
+    }
+
+public:
+    explicit ThreadPool(size_t threads) {
+        for (size_t i = 1; i < threads; i++) {
+            workers.emplace_back([this] {
+                std::unique_lock<std::mutex> lock(mutex);
+                while (true) {
+                    wake.wait(lock, [this] { return stopping || next_task < task_count; });
+                    if (stopping) return;
+                    work(lock);
+                }
+            });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers) worker.join();
+    }
+
+    // the number of threads that run tasks, the calling one included
+    size_t size() const {
+        return workers.size() + 1;
+    }
+
+    // calls f(0), ..., f(tasks - 1) and returns when all of them are done. Jobs started from inside a task
+    // run on the calling thread alone, so that they cannot wait for workers that are waiting for them.
+    // If tasks throw, the rest still run, and the first exception is rethrown once all are done
+    void run(size_t tasks, const std::function<void(size_t)>& f) {
+        if (workers.empty() || tasks <= 1 || inside_task()) {
+            for (size_t i = 0; i < tasks; i++) f(i);
+            return;
+        }
+        std::lock_guard<std::mutex> job_lock(job_mutex);
+        std::unique_lock<std::mutex> lock(mutex);
+        job = &f;
+        next_task = 0;
+        task_count = tasks;
+        unfinished = tasks;
+        wake.notify_all();
+        work(lock);
+        finished.wait(lock, [this] { return unfinished == 0; });
+        job = nullptr;
+        task_count = 0;
+        if (failure) std::rethrow_exception(std::exchange(failure, nullptr));
+    }
+};
+
+// the one pool behind pool() and set_thread_count(); the function is inline, so every translation unit
+// reaches the same static
+inline std::unique_ptr<ThreadPool>& pool_instance() {
+    static std::unique_ptr<ThreadPool> instance = std::make_unique<ThreadPool>(std::max(1u, std::thread::hardware_concurrency()));
+    return instance;
+}
+
+// the pool that the parallel algorithms of BigInteger and Matrix share, one thread per hardware thread by default
+inline ThreadPool& pool() {
+    return *pool_instance();
+}
+
+// replaces the shared pool; must not be called while it runs a job
+inline void set_thread_count(size_t threads) {
+    pool_instance() = std::make_unique<ThreadPool>(std::max<size_t>(1, threads));
+}
+
+// calls f(first, last) on consecutive ranges covering [begin, end), spread over the shared pool, with at
+// least grain indices in every range: fewer than 2 * grain indices are one range, and ranges differ in
+// length by at most one
+template<typename Function>
+void parallel_for(size_t begin, size_t end, size_t grain, Function f) {
+    if (begin >= end) return;
+    size_t count = end - begin;
+    size_t ranges = std::min(pool().size(), count / std::max<size_t>(grain, 1));
+    if (ranges <= 1) {
+        f(begin, end);
+        return;
+    }
+    pool().run(ranges, [&](size_t i) {
+        f(begin + i * count / ranges, begin + (i + 1) * count / ranges);
+    });
+}
+}